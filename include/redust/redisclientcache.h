@@ -0,0 +1,79 @@
+#ifndef REDISCLIENTCACHE_H
+#define REDISCLIENTCACHE_H
+
+// qt core
+#include <QByteArray>
+#include <QHash>
+
+/*
+ * Redis Client Cache
+ * - local cache of hash fields (keyed by hash name and field), a null value means the field doesn't exist
+ * - kept coherent by the invalidation messages of redis server-assisted client side caching (see RedisServer::enableClientCache)
+ * - least recently used entries are evicted, if the memory cap is reached
+ * see: http://redis.io/topics/client-side-caching
+ */
+class RedisClientCache
+{
+    public:
+        RedisClientCache(qint64 maxMemory);
+        ~RedisClientCache();
+
+        // lookup a cached field (returns false on a miss)
+        bool lookup(const QByteArray& key, const QByteArray& field, QByteArray& value);
+
+        // insert a field, which was read while the cache was at the given epoch
+        // Note: if any invalidation happened since then, the value may be outdated allready and is not cached
+        inline quint64 epoch() { return this->intEpoch; }
+        void insert(const QByteArray& key, const QByteArray& field, const QByteArray& value, quint64 epoch);
+
+        // invalidation
+        void invalidate(const QByteArray& key);
+        void clear();
+
+        // memory
+        inline qint64 maxMemory() { return this->intMaxMemory; }
+        inline qint64 memoryUsage() { return this->intMemoryUsage; }
+        void maxMemory(qint64 maxMemory);
+        inline int count() { return this->intCount; }
+
+        // stats
+        inline quint64 hits() { return this->intHits; }
+        inline quint64 misses() { return this->intMisses; }
+        inline quint64 evictions() { return this->intEvictions; }
+        inline quint64 invalidations() { return this->intInvalidations; }
+        void resetStats();
+
+    private:
+        // cache entry, which is also a node of the lru list (the most recently used entry is the head)
+        struct Entry
+        {
+            QByteArray key;
+            QByteArray field;
+            QByteArray value;
+            Entry* prev;
+            Entry* next;
+        };
+        static inline qint64 entrySize(const Entry* entry) { return sizeof(Entry) + entry->key.size() + entry->field.size() + entry->value.size(); }
+        void unlink(Entry* entry);
+        void pushFront(Entry* entry);
+        void remove(Entry* entry);
+
+        // entries by hash name and field
+        QHash<QByteArray, QHash<QByteArray, Entry*>> hashEntries;
+        Entry* lruHead = 0;
+        Entry* lruTail = 0;
+        int intCount = 0;
+
+        // memory and invalidation state
+        qint64 intMaxMemory;
+        qint64 intMemoryUsage = 0;
+        quint64 intEpoch = 0;
+
+        // stats
+        quint64 intHits = 0;
+        quint64 intMisses = 0;
+        quint64 intEvictions = 0;
+        quint64 intInvalidations = 0;
+};
+
+#endif // REDISCLIENTCACHE_H
@@ -0,0 +1,44 @@
+#ifndef REDISCOMMANDENCODER_H
+#define REDISCOMMANDENCODER_H
+
+// std lib
+#include <vector>
+#include <utility>
+
+// qt core
+#include <QByteArray>
+#include <QIODevice>
+
+/*
+ * Redis Command Encoder
+ * - encodes RESP commands directly into a reusable output buffer
+ * - large arguments are not copied into the output buffer, they are gathered by reference and written in order on flush
+ * see: http://redis.io/topics/protocol#sending-commands-to-a-redis-server
+ */
+class RedisCommandEncoder
+{
+    public:
+        RedisCommandEncoder(int initialBufferSize = 16384, int gatherThreshold = 16384);
+
+        // encoding
+        void beginArray(int count);
+        void appendRaw(const QByteArray& data);
+        void appendBulk(const QByteArray& data);
+
+        // output buffer handling
+        inline bool isEmpty() { return this->buffer.isEmpty() && this->lstGathered.empty(); }
+        inline qint64 size() { return this->intGatheredSize + this->buffer.size(); }
+        qint64 flush(QIODevice* device);
+        void clear();
+
+    private:
+        void appendInteger(qint64 value);
+
+        // output buffer and gathered (not copied) arguments including their position in the output buffer
+        QByteArray buffer;
+        std::vector<std::pair<int, QByteArray>> lstGathered;
+        qint64 intGatheredSize = 0;
+        int intGatherThreshold;
+};
+
+#endif // REDISCOMMANDENCODER_H
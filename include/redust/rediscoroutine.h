@@ -0,0 +1,124 @@
+#ifndef REDISCOROUTINE_H
+#define REDISCOROUTINE_H
+
+// redust
+#include "redisserver.h"
+
+// coroutines are only available for C++20 (e.g. CONFIG += c++2a)
+#if __cplusplus >= 202002L && defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+#define REDUST_COROUTINES
+
+// std lib
+#include <coroutine>
+#include <exception>
+#include <optional>
+#include <utility>
+
+/*
+ * Redis Awaitable
+ * - co_await-able result of an asyncron (or pipeline) request
+ * - suspends the awaiting coroutine without blocking the event loop, and resumes it when the reply of the request is handled
+ * - the result is transformed out of the finished request (e.g. into a deserialized value)
+ * Note: the coroutine is resumed in the thread, which handles the reply (the thread of the RedisServer)
+ */
+template<typename T>
+class RedisAwaitable
+{
+    public:
+        typedef std::function<T(RedisServer::RedisRequest)> Transform;
+
+        RedisAwaitable(RedisServer::RedisRequest request, Transform transform) : request(request), transform(transform) { }
+
+        // awaiter interface
+        bool await_ready() { return this->request->isFinished(); }
+        void await_suspend(std::coroutine_handle<> handle) { this->request->then([handle](RedisServer::RedisRequest) { handle.resume(); }); }
+        T await_resume() { return this->transform(this->request); }
+
+    private:
+        RedisServer::RedisRequest request;
+        Transform transform;
+};
+
+// every request is awaitable by itself: RedisServer::RedisRequest request = co_await server.hget(list, key, RedisServer::RequestType::Asyncron);
+inline RedisAwaitable<RedisServer::RedisRequest> operator co_await(RedisServer::RedisRequest request)
+{
+    return RedisAwaitable<RedisServer::RedisRequest>(request, [](RedisServer::RedisRequest request) { return request; });
+}
+
+/*
+ * Redis Task
+ * - return type of coroutines, which await redis requests (e.g. RedisTask<int> count() { ...; co_return 1; })
+ * - the coroutine is started instantly, and can be awaited by other coroutines
+ * - if the task is destroyed before the coroutine is done, the coroutine keeps running detached and cleans up itself
+ */
+template<typename T = void>
+class RedisTask
+{
+    public:
+        // promise of the coroutine (result handling is specialized for void below)
+        struct PromiseBase
+        {
+            std::suspend_never initial_suspend() noexcept { return {}; }
+            void unhandled_exception() { this->exception = std::current_exception(); }
+
+            // resume the awaiting coroutine when done (or destroy the coroutine, if it's task is gone)
+            struct FinalAwaiter
+            {
+                bool await_ready() noexcept { return false; }
+                template<typename Promise>
+                std::coroutine_handle<> await_suspend(std::coroutine_handle<Promise> handle) noexcept
+                {
+                    std::coroutine_handle<> continuation = handle.promise().continuation;
+                    if(handle.promise().detached) handle.destroy();
+                    return continuation ? continuation : std::noop_coroutine();
+                }
+                void await_resume() noexcept { }
+            };
+            FinalAwaiter final_suspend() noexcept { return {}; }
+
+            std::coroutine_handle<> continuation;
+            std::exception_ptr exception;
+            bool detached = false;
+        };
+        struct ValuePromise : public PromiseBase
+        {
+            RedisTask get_return_object() { return RedisTask(std::coroutine_handle<ValuePromise>::from_promise(*this)); }
+            template<typename V> void return_value(V&& value) { this->value = std::forward<V>(value); }
+            std::optional<T> value;
+        };
+        struct VoidPromise : public PromiseBase
+        {
+            RedisTask get_return_object() { return RedisTask(std::coroutine_handle<VoidPromise>::from_promise(*this)); }
+            void return_void() { }
+        };
+        typedef typename std::conditional<std::is_void<T>::value, VoidPromise, ValuePromise>::type promise_type;
+
+        RedisTask(RedisTask&& other) : handle(std::exchange(other.handle, nullptr)) { }
+        RedisTask(const RedisTask&) = delete;
+        ~RedisTask()
+        {
+            if(!this->handle) return;
+            if(this->handle.done()) this->handle.destroy();
+            else this->handle.promise().detached = true;
+        }
+
+        // state
+        bool isFinished() { return !this->handle || this->handle.done(); }
+
+        // awaiter interface
+        bool await_ready() { return this->isFinished(); }
+        void await_suspend(std::coroutine_handle<> continuation) { this->handle.promise().continuation = continuation; }
+        T await_resume()
+        {
+            if(this->handle.promise().exception) std::rethrow_exception(this->handle.promise().exception);
+            if constexpr(!std::is_void<T>::value) return std::move(*this->handle.promise().value);
+        }
+
+    private:
+        explicit RedisTask(std::coroutine_handle<promise_type> handle) : handle(handle) { }
+        std::coroutine_handle<promise_type> handle;
+};
+
+#endif // C++20 coroutines
+
+#endif // REDISCOROUTINE_H
@@ -0,0 +1,237 @@
+#ifndef REDISDECODER_H
+#define REDISDECODER_H
+
+// redust
+#include "redust/redisserver.h"
+#include "redust/typeserializer.h"
+
+// qtcore
+#include <QHash>
+#include <QMap>
+#include <QList>
+
+// std lib
+#include <type_traits>
+
+/*
+ * Redis Decoder
+ * - typed commands, which declare the type of their reply statically (integer, bulk, array, array of pairs or scan page)
+ * - the reply is decoded directly out of the receive buffer into the target of the caller (see RedisServer::execDecoded), no request is built for it
+ * - decoders are specialized at compile time by their target, keys and values are deserialized by the TypeSerializer of their type
+ * - containers are reserved by the length of the RESP array, before the elements are inserted
+ * - streamed commands hand every element to a visitor while the reply is received (see RedisServer::execStreamed), so they never store the whole reply
+ * Note: typed commands are syncron, values of arithmetic types are deserialized without copying them out of the receive buffer
+ */
+namespace RedisDecoder
+{
+    // deserialize an element (length is -1 for null elements)
+    template<typename T>
+    inline NORM2VALUE(T) element(const char* data, int length, bool binarize)
+    {
+        QByteArray value = length < 0 ? QByteArray() : std::is_arithmetic<NORM2VALUE(T)>::value ? QByteArray::fromRawData(data, length) : QByteArray(data, length);
+        return TypeSerializer<T>::deserialize(&value, binarize);
+    }
+
+    // deserialize an element of a flat array
+    template<typename T>
+    inline NORM2VALUE(T) element(const RedisServer::RedisResponseArray& array, int index, bool binarize)
+    {
+        return element<T>(array.data(index), array.length(index), binarize);
+    }
+
+    // reserve space for additional elements (maps can't be reserved)
+    template<typename Key, typename Value>
+    inline void reserve(QHash<Key, Value>& container, int size) { container.reserve(container.size() + size); }
+    template<typename Key, typename Value>
+    inline void reserve(QMap<Key, Value>&, int) { }
+    template<typename T>
+    inline void reserve(QList<T>& container, int size) { container.reserve(container.size() + size); }
+
+    /* Integer reply (e.g. HLEN) */
+    template<typename T>
+    struct Integer
+    {
+        Integer(T& target) : target(target) { }
+        void operator ()(const RedisServer::RedisReply& reply) { this->target = (T)reply.integer(); }
+
+        T& target;
+    };
+
+    /* Bulk reply (e.g. HGET), the target is kept for a null reply */
+    template<typename T>
+    struct Bulk
+    {
+        Bulk(NORM2VALUE(T)& target, bool binarize, bool* found = 0) : target(target), binarize(binarize), found(found) { }
+        void operator ()(const RedisServer::RedisReply& reply)
+        {
+            if(this->found) *this->found = !reply.isNull();
+            if(reply.isNull()) return;
+            QByteArray value = std::is_arithmetic<NORM2VALUE(T)>::value ? reply.rawString() : reply.string();
+            this->target = TypeSerializer<T>::deserialize(&value, this->binarize);
+        }
+
+        NORM2VALUE(T)& target;
+        bool binarize;
+        bool* found;
+    };
+
+    /* Array reply (e.g. HKEYS, HVALS or HMGET), every step'th element beginning at first is appended */
+    template<typename T>
+    struct List
+    {
+        List(QList<NORM2VALUE(T)>& target, bool binarize, int first = 0, int step = 1) : target(target), binarize(binarize), first(first), step(step) { }
+        void operator ()(const RedisServer::RedisReply& reply)
+        {
+            RedisServer::RedisResponseArray array = reply.array();
+            if(array.size() <= this->first) return;
+            reserve(this->target, (array.size() - this->first + this->step - 1) / this->step);
+            for(int i = this->first; i < array.size(); i += this->step) this->target.append(element<T>(array, i, this->binarize));
+        }
+
+        QList<NORM2VALUE(T)>& target;
+        bool binarize;
+        int first;
+        int step;
+    };
+
+    /* Array of pairs (e.g. HGETALL, or a map of RESP3), keys and values alternate */
+    template<typename Key, typename Value, typename Container>
+    struct Pairs
+    {
+        Pairs(Container& target, bool binarizeKey, bool binarizeValue) : target(target), binarizeKey(binarizeKey), binarizeValue(binarizeValue) { }
+        void operator ()(const RedisServer::RedisReply& reply)
+        {
+            RedisServer::RedisResponseArray array = reply.array();
+            reserve(this->target, array.size() / 2);
+            for(int i = 0; i + 1 < array.size(); i += 2) this->target.insert(element<Key>(array, i, this->binarizeKey), element<Value>(array, i + 1, this->binarizeValue));
+        }
+
+        Container& target;
+        bool binarizeKey;
+        bool binarizeValue;
+    };
+
+    /* Scan page (e.g. HSCAN), the cursor is stored and the scanned elements are decoded by the decoder of the page */
+    template<typename Elements>
+    struct ScanPage
+    {
+        ScanPage(int& cursor, Elements elements) : cursor(cursor), elements(elements) { }
+        void operator ()(const RedisServer::RedisReply& reply)
+        {
+            this->cursor = reply.at(0).integer();
+            this->elements(reply.at(1));
+        }
+
+        int& cursor;
+        Elements elements;
+    };
+    template<typename Elements>
+    inline ScanPage<Elements> scanPage(int& cursor, Elements elements) { return ScanPage<Elements>(cursor, elements); }
+
+    // Typed Hash Redis Functions
+    template<typename T>
+    inline bool hlen(RedisServer& server, const QByteArray& list, T& count)
+    {
+        // Build and execute Command
+        // HLEN list
+        // src: http://redis.io/commands/hlen
+        return server.execDecoded(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$4\r\nHLEN\r\n"), "HLEN", { list }), Integer<T>(count));
+    }
+
+    template<typename T>
+    inline bool hget(RedisServer& server, const QByteArray& list, const QByteArray& key, NORM2VALUE(T)& value, bool binarize, bool* found = 0)
+    {
+        // Build and execute Command
+        // HGET list key
+        // src: http://redis.io/commands/hget
+        return server.execDecoded(RedisServer::RedisCommand(QByteArrayLiteral("*3\r\n$4\r\nHGET\r\n"), "HGET", { list, key }), Bulk<T>(value, binarize, found));
+    }
+
+    template<typename Key, typename Value, typename Container>
+    inline bool hgetall(RedisServer& server, const QByteArray& list, Container& entries, bool binarizeKey, bool binarizeValue)
+    {
+        // Build and execute Command
+        // HGETALL list
+        // src: http://redis.io/commands/hgetall
+        return server.execDecoded(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$7\r\nHGETALL\r\n"), "HGETALL", { list }), Pairs<Key, Value, Container>(entries, binarizeKey, binarizeValue));
+    }
+
+    template<typename T>
+    inline bool hkeys(RedisServer& server, const QByteArray& list, QList<NORM2VALUE(T)>& keys, bool binarize)
+    {
+        // Build and execute Command
+        // HKEYS list
+        // src: http://redis.io/commands/hkeys
+        return server.execDecoded(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHKEYS\r\n"), "HKEYS", { list }), List<T>(keys, binarize));
+    }
+
+    template<typename T>
+    inline bool hvals(RedisServer& server, const QByteArray& list, QList<NORM2VALUE(T)>& values, bool binarize)
+    {
+        // Build and execute Command
+        // HVALS list
+        // src: http://redis.io/commands/hvals
+        return server.execDecoded(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHVALS\r\n"), "HVALS", { list }), List<T>(values, binarize));
+    }
+
+    template<typename T>
+    inline bool hmget(RedisServer& server, const QByteArray& list, const std::vector<QByteArray>& keys, QList<NORM2VALUE(T)>& values, bool binarize)
+    {
+        // Build and execute Command
+        // HMGET list [ key ] ...
+        // src: http://redis.io/commands/hmget
+        std::vector<QByteArray> args;
+        args.reserve(1 + keys.size());
+        args.push_back(list);
+        args.insert(args.end(), keys.begin(), keys.end());
+        return server.execDecoded(RedisServer::RedisCommand(QByteArrayLiteral("$5\r\nHMGET\r\n"), "HMGET", args), List<T>(values, binarize));
+    }
+
+    template<typename Elements>
+    inline bool hscan(RedisServer& server, const QByteArray& list, int& cursor, Elements elements, int count = -1, const QByteArray& pattern = QByteArray())
+    {
+        // Build and execute Command
+        // HSCAN list cursor [MATCH pattern] [COUNT count]
+        // src: http://redis.io/commands/hscan
+        std::vector<QByteArray> args;
+        args.reserve(6);
+        args.push_back(list);
+        args.push_back(QByteArray::number(cursor));
+        if(!pattern.isEmpty()) {
+            args.push_back("MATCH");
+            args.push_back(pattern);
+        }
+        if(count != -1) {
+            args.push_back("COUNT");
+            args.push_back(QByteArray::number(count));
+        }
+        return server.execDecoded(RedisServer::RedisCommand("HSCAN", args), scanPage(cursor, elements));
+    }
+
+    // Streamed Hash Redis Functions (HGETALL visits keys and values alternately)
+    inline bool streamHgetall(RedisServer& server, const QByteArray& list, RedisServer::ElementVisitor visitor)
+    {
+        // Build and execute Command
+        // HGETALL list
+        // src: http://redis.io/commands/hgetall
+        return server.execStreamed(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$7\r\nHGETALL\r\n"), "HGETALL", { list }), visitor);
+    }
+
+    inline bool streamHkeys(RedisServer& server, const QByteArray& list, RedisServer::ElementVisitor visitor)
+    {
+        // Build and execute Command
+        // HKEYS list
+        // src: http://redis.io/commands/hkeys
+        return server.execStreamed(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHKEYS\r\n"), "HKEYS", { list }), visitor);
+    }
+
+    inline bool streamHvals(RedisServer& server, const QByteArray& list, RedisServer::ElementVisitor visitor)
+    {
+        // Build and execute Command
+        // HVALS list
+        // src: http://redis.io/commands/hvals
+        return server.execStreamed(RedisServer::RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHVALS\r\n"), "HVALS", { list }), visitor);
+    }
+}
+
+#endif // REDISDECODER_H
@@ -7,6 +7,14 @@
 // redis
 #include "typeserializer.h"
 #include "redisserver.h"
+#include "redispipeline.h"
+#include "redistransaction.h"
+#include "redisdecoder.h"
+#include "rediscoroutine.h"
+
+// std lib
+#include <map>
+#include <type_traits>
 
 template< typename Key, typename Value >
 class RedisHash
@@ -18,21 +26,27 @@ class RedisHash
             iterator& operator =(iterator other)
             {
                 this->list = other.list;
+                this->baseList = other.baseList;
+                this->buckets = other.buckets;
+                this->bucket = other.bucket;
                 this->redisServer = other.redisServer;
                 this->pos = other.pos;
                 this->posRedis = other.posRedis;
                 this->cacheSize = other.cacheSize;
                 this->queueElements = other.queueElements;
+                this->queuePos = other.queuePos;
                 this->binarizeKey = other.binarizeKey;
                 this->binarizeValue = other.binarizeValue;
 
+                // copy current entry
+                this->currentElements = other.currentElements;
+                this->currentPos = other.currentPos;
+
                 // copy key data
-                this->currentKey = other.currentKey;
                 this->currentKeyVal = other.currentKeyVal;
                 this->keyLoaded = other.keyLoaded;
 
                 // copy value data
-                this->currentValue = other.currentValue;
                 this->currentValueVal = other.currentValueVal;
                 this->valueLoaded = other.valueLoaded;
 
@@ -53,8 +67,8 @@ class RedisHash
             }
             iterator erase(RedisServer::RequestType type = RedisServer::RequestType::Syncron)
             {
-                if(this->currentKey.isEmpty()) return *this;
-                this->redisServer->hdel(this->list, this->currentKey, type);
+                if(this->currentPos == -1) return *this;
+                this->redisServer->hdel(this->list, this->currentElements.at(this->currentPos), type);
                 return this->forward(1);
             }
 
@@ -69,9 +83,9 @@ class RedisHash
             // comparing operator overloadings
             bool operator ==(iterator other)
             {
-                return this->list == other.list &&
+                return this->baseList == other.baseList &&
                        this->pos == other.pos &&
-                       this->queueElements.size() == other.queueElements.size();
+                       this->queueElements.size() - this->queuePos == other.queueElements.size() - other.queuePos;
             }
             bool operator !=(iterator other)
             {
@@ -101,9 +115,11 @@ class RedisHash
             }
 
         private:
-            iterator(RedisServer& redisServer, QByteArray list, int pos, int cacheSize, bool binarizeKey, bool binarizeValue)
+            iterator(RedisServer& redisServer, QByteArray list, int buckets, int pos, int cacheSize, bool binarizeKey, bool binarizeValue)
             {
-                this->list = list;
+                this->baseList = list;
+                this->buckets = buckets;
+                this->list = RedisHash::bucketName(list, buckets, 0);
                 this->redisServer = &redisServer;
                 this->cacheSize = cacheSize;
                 this->binarizeKey = binarizeKey;
@@ -125,11 +141,11 @@ class RedisHash
                 for(int i = 0; i < elements; i++) {
                     if(!this->refillQueue()) return *this;
 
-                    // save current key and value
-                    this->currentKey = this->queueElements.front();
-                    this->queueElements.pop_front();
-                    this->currentValue = this->queueElements.front();
-                    this->queueElements.pop_front();
+                    // save current key and value position
+                    // Note: the key and value are deserialized on demand (see loadEntry)
+                    this->currentElements = this->queueElements;
+                    this->currentPos = this->queuePos;
+                    this->queuePos += 2;
                 }
                 return *this;
             }
@@ -137,10 +153,15 @@ class RedisHash
             bool refillQueue()
             {
                 // if queue is not empty, don't refill
-                if(this->queueElements.size() > 0) return true;
-
-                // if we reach the end of the redis position, set current pos to -1 and exit
-                if(this->posRedis == 0) this->pos = -1;
+                if(this->queuePos < this->queueElements.size()) return true;
+
+                // if we reach the end of the redis position, continue with the next bucket (or set current pos to -1 and exit)
+                if(this->posRedis == 0) {
+                    if(++this->bucket < this->buckets) {
+                        this->list = RedisHash::bucketName(this->baseList, this->buckets, this->bucket);
+                        this->posRedis = -1;
+                    } else this->pos = -1;
+                }
                 if(this->pos == -1) return false;
 
                 // if redis pos is set to -1 (it's an invalid position) set position to begin
@@ -150,7 +171,8 @@ class RedisHash
                 // refill queue
                 RedisServer::RedisResponse response = this->redisServer->hscan(this->list, QByteArray::number(this->posRedis), this->cacheSize)->response();
                 this->posRedis = response->cursor();
-                this->queueElements = response->array();
+                this->queueElements = response->reply().at(1).array();
+                this->queuePos = 0;
 
                 // if we couldn't get any items then we reached the end
                 // Note: this could happend if we try to get data from an non-existing/empty key
@@ -162,13 +184,13 @@ class RedisHash
             {
                 // load key (if not allready happened)
                 if(key && !this->keyLoaded) {
-                    this->currentKeyVal = TypeSerializer<Key>::deserialize(this->currentKey, this->binarizeKey);
+                    this->currentKeyVal = RedisDecoder::element<Key>(this->currentElements, this->currentPos, this->binarizeKey);
                     this->keyLoaded = true;
                 }
 
                 // load value (if not allready happened)
                 if(value && !this->valueLoaded) {
-                    this->currentValueVal = TypeSerializer<Value>::deserialize(this->currentValue, this->binarizeValue);
+                    this->currentValueVal = RedisDecoder::element<Value>(this->currentElements, this->currentPos + 1, this->binarizeValue);
                     this->valueLoaded = true;
                 }
             }
@@ -177,9 +199,10 @@ class RedisHash
             int cacheSize;
             int posRedis = -1;
             int pos;
-            std::list<QByteArray> queueElements;
-            QByteArray currentKey;
-            QByteArray currentValue;
+            RedisServer::RedisResponseArray queueElements;
+            int queuePos = 0;
+            RedisServer::RedisResponseArray currentElements;
+            int currentPos = -1;
             NORM2VALUE(Key) currentKeyVal;
             NORM2VALUE(Value) currentValueVal;
             bool keyLoaded = false;
@@ -187,20 +210,35 @@ class RedisHash
             bool binarizeKey = false;
             bool binarizeValue = false;
             QByteArray list;
+            QByteArray baseList;
+            int buckets = 1;
+            int bucket = 0;
             RedisServer* redisServer;
 
         friend class RedisHash;
     };
 
     public:
-        RedisHash(RedisServer& redisServer, QByteArray list, bool binarizeKey = false, bool binarizeValue = false)
+        // Note: a hash with more than one bucket is split into small physical hashes ("<list>:<bucket>"), which stay in redis' compact listpack encoding
+        //       (see bucketsFor, the bucket of a field is fixed, so the bucket count of a hash must not change while it contains data)
+        RedisHash(RedisServer& redisServer, QByteArray list, bool binarizeKey = false, bool binarizeValue = false, int buckets = 1)
         {
             this->redisServer = &redisServer;
             this->binarizeKey = binarizeKey;
             this->binarizeValue = binarizeValue;
             this->list = list;
+            this->intBuckets = qMax(buckets, 1);
         }
 
+        // bucket count, which keeps every bucket below maxBucketFields (redis' hash-max-listpack-entries, values must stay below hash-max-listpack-value as well)
+        // Note: fields are not distributed perfectly even, so the buckets are filled up to 75%
+        static int bucketsFor(qint64 fields, int maxBucketFields = 128)
+        {
+            qint64 bucketFields = qMax(maxBucketFields * 3 / 4, 1);
+            return (int)qMax((fields + bucketFields - 1) / bucketFields, (qint64)1);
+        }
+        int buckets() { return this->intBuckets; }
+
         ~RedisHash()
         {
 
@@ -208,12 +246,12 @@ class RedisHash
 
         iterator begin(int cacheSize = 100)
         {
-            return iterator(*this->redisServer, this->list, 0, cacheSize, this->binarizeKey, this->binarizeValue);
+            return iterator(*this->redisServer, this->list, this->intBuckets, 0, cacheSize, this->binarizeKey, this->binarizeValue);
         }
 
         iterator end(int cacheSize = 100)
         {
-            return iterator(*this->redisServer, this->list, -1, cacheSize, this->binarizeKey, this->binarizeValue);
+            return iterator(*this->redisServer, this->list, this->intBuckets, -1, cacheSize, this->binarizeKey, this->binarizeValue);
         }
 
         iterator erase(iterator pos, bool waitForAnswer = true)
@@ -223,12 +261,28 @@ class RedisHash
 
         bool clear(RedisServer::RequestType type = RedisServer::RequestType::Syncron)
         {
-            return !this->redisServer->del(this->list, type)->hasError();
+            // buckets are deleted with one round trip (if syncron)
+            if(this->intBuckets == 1 || type != RedisServer::RequestType::Syncron) {
+                bool success = true;
+                for(int i = 0; i < this->intBuckets; i++) success = !this->redisServer->del(this->bucketList(i), type)->hasError() && success;
+                return success;
+            }
+            QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::del);
+            for(auto itr = requests.begin(); itr != requests.end(); itr++) if((*itr)->hasError()) return false;
+            return true;
         }
 
         int count()
         {
-            return this->redisServer->hlen(this->list, RedisServer::RequestType::Syncron)->response()->integer();
+            // a single hash decodes the HLEN reply directly into the count
+            int count = 0;
+            if(this->intBuckets == 1) {
+                RedisDecoder::hlen(*this->redisServer, this->list, count);
+                return count;
+            }
+            QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::hlen);
+            for(auto itr = requests.begin(); itr != requests.end(); itr++) count += (*itr)->response()->integer();
+            return count;
         }
 
         bool empty()
@@ -243,64 +297,177 @@ class RedisHash
 
         bool exists(Key key)
         {
-            return this->redisServer->hexists(this->list, TypeSerializer<Key>::serialize(key, this->binarizeKey), RedisServer::RequestType::Syncron)->response()->integer() == 1;
+            // use the client cache if available (a not existing field is cached as null value)
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            if(this->redisServer->clientCache()) return !this->redisServer->cachedHget(this->bucketList(sKey), sKey).isNull();
+            return this->redisServer->hexists(this->bucketList(sKey), sKey, RedisServer::RequestType::Syncron)->response()->integer() == 1;
+        }
+
+        QList<bool> exists(QList<Key> keys)
+        {
+            // use the client cache if available
+            QList<bool> results;
+            if(this->redisServer->clientCache()) {
+                for(auto itr = keys.begin(); itr != keys.end(); itr++) results.append(this->exists(*itr));
+                return results;
+            }
+
+            // otherwise check all fields with one round trip
+            RedisPipeline batch(*this->redisServer, RedisServer::ConnectionType::Blocked);
+            QList<RedisServer::RedisRequest> requests;
+            for(auto itr = keys.begin(); itr != keys.end(); itr++) {
+                QByteArray sKey = TypeSerializer<Key>::serialize(*itr, this->binarizeKey);
+                requests.append(batch.exec(&RedisServer::hexists, this->bucketList(sKey), sKey));
+            }
+            batch.flush();
+            for(auto itr = requests.begin(); itr != requests.end(); itr++) results.append((*itr)->response()->integer() == 1);
+            return results;
         }
 
         bool exists()
         {
-            return this->redisServer->exists(this->list, RedisServer::RequestType::Syncron)->response()->integer() == 1;
+            // the hash exists, as long as one of it's buckets exists
+            QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::exists);
+            for(auto itr = requests.begin(); itr != requests.end(); itr++) if((*itr)->response()->integer() == 1) return true;
+            return false;
         }
 
         bool remove(Key key, RedisServer::RequestType type = RedisServer::RequestType::Syncron)
         {
-            return !this->redisServer->hdel(this->list, TypeSerializer<Key>::serialize(key, this->binarizeKey), type)->hasError();
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            return !this->redisServer->hdel(this->bucketList(sKey), sKey, type)->hasError();
+        }
+
+        bool remove(QList<Key> keys, RedisServer::RequestType type = RedisServer::RequestType::Syncron)
+        {
+            // syncron, all fields are removed atomically with one round trip (otherwise every field is removed by an own request of the given type)
+            QList<QByteArray> sKeys;
+            for(auto itr = keys.begin(); itr != keys.end(); itr++) sKeys.append(TypeSerializer<Key>::serialize(*itr, this->binarizeKey));
+            return this->execFields(sKeys, QList<QByteArray>(), type);
         }
 
         NORM2VALUE(Value) take(Key key, RedisServer::RequestType type = RedisServer::RequestType::Syncron, bool *removeResult = 0)
         {
+            // read and remove the field atomically with one round trip (by the take script)
+            if(type == RedisServer::RequestType::Syncron) {
+                QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+                RedisServer::RedisRequest request = this->evalScript(RedisHash::takeScript(), { this->bucketList(sKey) }, { "1", sKey });
+                if(removeResult) *removeResult = request->isSuccess() && !request->response()->hasError();
+                return TypeSerializer<Value>::deserialize(request->response()->reply().at(0).string(), this->binarizeValue);
+            }
+
+            // otherwise the removal is executed by type
             NORM2VALUE(Value) value = this->value(key);
             bool rResult = this->remove(key, type);
             if(removeResult) *removeResult = rResult;
             return value;
         }
 
+        QList<NORM2VALUE(Value)> takeMany(QList<Key> keys)
+        {
+            // read and remove all fields atomically with one round trip (KEYS are the buckets, ARGV contains the bucket index and the field of every field)
+            QList<int> buckets;
+            QList<std::list<QByteArray>> sKeys;
+            QList<QList<int>> positions;
+            this->groupBuckets(keys, buckets, sKeys, positions);
+            if(buckets.isEmpty()) return QList<NORM2VALUE(Value)>();
+            QList<RedisServer::RedisRequest> requests;
+            if(buckets.size() == 1 || !this->redisServer->isCluster()) {
+                std::list<QByteArray> lists, args;
+                QList<int> order;
+                for(int i = 0; i < buckets.size(); i++) {
+                    lists.push_back(this->bucketList(buckets.at(i)));
+                    for(auto itr = sKeys.at(i).begin(); itr != sKeys.at(i).end(); itr++) {
+                        args.push_back(QByteArray::number(i + 1));
+                        args.push_back(*itr);
+                    }
+                    order.append(positions.at(i));
+                }
+                requests.append(this->evalScript(RedisHash::takeScript(), lists, args));
+                positions = QList<QList<int>>() << order;
+            }
+
+            // buckets of a cluster may belong to different slots, so every bucket is taken by it's own script (but with one round trip)
+            else {
+                QByteArray sha = this->redisServer->loadScript(RedisHash::takeScript());
+                RedisPipeline batch(*this->redisServer, RedisServer::ConnectionType::Blocked, QByteArray(), buckets.size() + 1);
+                for(int i = 0; i < buckets.size(); i++) {
+                    std::list<QByteArray> args;
+                    for(auto itr = sKeys.at(i).begin(); itr != sKeys.at(i).end(); itr++) {
+                        args.push_back("1");
+                        args.push_back(*itr);
+                    }
+                    requests.append(batch.exec(&RedisServer::evalScript, sha, std::list<QByteArray> { this->bucketList(buckets.at(i)) }, args));
+                }
+                batch.flush();
+            }
+            return RedisHash::mergeBuckets(requests, positions, keys.size(), this->binarizeValue);
+        }
+
+        bool compareAndSet(Key key, Value expected, Value value)
+        {
+            // the field is replaced atomically with one round trip, if it contains the expected value
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            return this->evalScript(RedisHash::compareAndSetScript(), { this->bucketList(sKey) },
+                                    { sKey, TypeSerializer<Value>::serialize(expected, this->binarizeValue), TypeSerializer<Value>::serialize(value, this->binarizeValue) })->response()->integer() == 1;
+        }
+
+        bool moveTo(Key key, RedisHash<Key, Value>& target)
+        {
+            // the field is moved atomically with one round trip (returns false, if the field doesn't exist)
+            // Note: the value is moved as it's stored, so both hashes have to serialize their values the same way (in a cluster both hashes need the same hash tag)
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            QByteArray sTargetKey = TypeSerializer<Key>::serialize(key, target.binarizeKey);
+            return this->evalScript(RedisHash::moveScript(), { this->bucketList(sKey), target.bucketList(sTargetKey) }, { sKey, sTargetKey })->response()->integer() == 1;
+        }
+
         bool insert(Key key, Value value, RedisServer::RequestType type = RedisServer::RequestType::Asyncron, bool replace = true)
         {
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
             if(replace) {
-                return !this->redisServer->hset(this->list,
-                                                TypeSerializer<Key>::serialize(key, this->binarizeKey),
+                return !this->redisServer->hset(this->bucketList(sKey), sKey,
                                                 TypeSerializer<Value>::serialize(value, this->binarizeValue), type)->hasError();
             } else {
-                return !this->redisServer->hsetnx(this->list,
-                                                  TypeSerializer<Key>::serialize(key, this->binarizeKey),
+                return !this->redisServer->hsetnx(this->bucketList(sKey), sKey,
                                                   TypeSerializer<Value>::serialize(value, this->binarizeValue), type)->hasError();
             }
         }
 
-        bool insert(QMap<Key, Value> values, RedisServer::RequestType type = RedisServer::RequestType::Asyncron)
+        // Note: without replace, fields which exist allready are kept (syncron, the fields are inserted atomically with one round trip)
+        bool insert(QMap<Key, Value> values, RedisServer::RequestType type = RedisServer::RequestType::Asyncron, bool replace = true)
         {
-            return !this->redisServer->hmset(this->list, values.keys().toStdList(), values.values().toStdList(), type)->hasError();
+            return this->insertBuckets(values.keys(), values.values(), type, replace);
         }
 
-        bool insert(QHash<Key, Value> values, RedisServer::RequestType type = RedisServer::RequestType::Asyncron)
+        bool insert(QHash<Key, Value> values, RedisServer::RequestType type = RedisServer::RequestType::Asyncron, bool replace = true)
         {
-            return !this->redisServer->hmset(this->list, values.keys().toStdList(), values.values().toStdList(), type)->hasError();
+            return this->insertBuckets(values.keys(), values.values(), type, replace);
         }
 
-        bool insert(QList<Key> keys, QList<Value> values, RedisServer::RequestType type = RedisServer::RequestType::Asyncron)
+        bool insert(QList<Key> keys, QList<Value> values, RedisServer::RequestType type = RedisServer::RequestType::Asyncron, bool replace = true)
         {
             if(keys.count() != values.count()) return false;
-            return !this->redisServer->hmset(this->list, keys.toStdList(), values.toStdList(), type)->hasError();
+            return this->insertBuckets(keys, values, type, replace);
         }
 
         NORM2VALUE(Value) value(Key key)
         {
-            return TypeSerializer<Value>::deserialize(this->redisServer->hget(this->list, TypeSerializer<Key>::serialize(key, this->binarizeKey), RedisServer::RequestType::Syncron)->response()->string(), this->binarizeValue);
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            if(this->redisServer->clientCache()) return TypeSerializer<Value>::deserialize(this->redisServer->cachedHget(this->bucketList(sKey), sKey), this->binarizeValue);
+
+            // otherwise the HGET reply is decoded directly into the value (a missing field is deserialized from an empty value, like before)
+            NORM2VALUE(Value) value = {};
+            bool found = false;
+            RedisDecoder::hget<Value>(*this->redisServer, this->bucketList(sKey), sKey, value, this->binarizeValue, &found);
+            return found ? value : TypeSerializer<Value>::deserialize(QByteArray(), this->binarizeValue);
         }
 
         int valueLength(Key key)
         {
-            return this->redisServer->hstrlen(this->list, TypeSerializer<Key>::serialize(key, this->binarizeKey), RedisServer::RequestType::Syncron)->response()->integer();
+            // use the client cache if available
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            if(this->redisServer->clientCache()) return this->redisServer->cachedHget(this->bucketList(sKey), sKey).size();
+            return this->redisServer->hstrlen(this->bucketList(sKey), sKey, RedisServer::RequestType::Syncron)->response()->integer();
         }
 
         QList<NORM2VALUE(Key)> keys(int fetchChunkSize = -1, QByteArray pattern = "")
@@ -309,24 +476,14 @@ class RedisHash
             QList<NORM2VALUE(Key)> list;
 
             // if fetch chunk size is smaller or equal 0, so exec hkeys
-            std::list<QByteArray> elements;
-            if(fetchChunkSize <= 0) elements.splice(elements.end(), this->redisServer->hkeys(this->list, RedisServer::RequestType::Syncron)->response()->array());
-
-            // otherwise get keys using scan
-            else {
-                int pos = 0;
-                do {
-                    RedisServer::RedisResponse response = this->redisServer->hscan(this->list, QByteArray::number(pos), fetchChunkSize, pattern, RedisServer::RequestType::Syncron)->response();
-                    pos = response->cursor();
-                    elements.splice(elements.end(), response->array());
-                } while(pos);
+            if(fetchChunkSize <= 0 && this->intBuckets == 1) RedisDecoder::hkeys<Key>(*this->redisServer, this->list, list, this->binarizeKey);
+            else if(fetchChunkSize <= 0) {
+                QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::hkeys);
+                for(auto itr = requests.begin(); itr != requests.end(); itr++) this->appendElements<Key>(list, (*itr)->response()->array(), 0, 1, this->binarizeKey);
             }
 
-            // deserialize byte array data to Key Type
-            for(auto itr = elements.begin(); itr != elements.end(); itr++) {
-                list.append(TypeSerializer<Key>::deserialize(*itr, this->binarizeKey));
-                if(fetchChunkSize > 0) itr++;
-            }
+            // otherwise get keys using scan
+            else this->scanBuckets(fetchChunkSize, pattern, RedisDecoder::List<Key>(list, this->binarizeKey, 0, 2));
 
             // return list
             return list;
@@ -338,24 +495,14 @@ class RedisHash
             QList<NORM2VALUE(Value)> list;
 
             // if fetch chunk size is smaller or equal 0, so exec hvals
-            std::list<QByteArray> elements;
-            if(fetchChunkSize <= 0) elements.splice(elements.end(), this->redisServer->hvals(this->list, RedisServer::RequestType::Syncron)->response()->array());
-
-            // otherwise get values using scan
-            else {
-                int pos = 0;
-                do {
-                    RedisServer::RedisResponse response = this->redisServer->hscan(this->list, QByteArray::number(pos), fetchChunkSize, pattern, RedisServer::RequestType::Syncron)->response();
-                    pos = response->cursor();
-                    elements.splice(elements.end(), response->array());
-                } while(pos);
+            if(fetchChunkSize <= 0 && this->intBuckets == 1) RedisDecoder::hvals<Value>(*this->redisServer, this->list, list, this->binarizeValue);
+            else if(fetchChunkSize <= 0) {
+                QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::hvals);
+                for(auto itr = requests.begin(); itr != requests.end(); itr++) this->appendElements<Value>(list, (*itr)->response()->array(), 0, 1, this->binarizeValue);
             }
 
-            // deserialize byte array data to Value Type
-            for(auto itr = elements.begin(); itr != elements.end(); itr++) {
-                if(fetchChunkSize > 0) itr++;
-                list.append(TypeSerializer<Value>::deserialize(*itr, this->binarizeValue));
-            }
+            // otherwise get values using scan
+            else this->scanBuckets(fetchChunkSize, pattern, RedisDecoder::List<Value>(list, this->binarizeValue, 1, 2));
 
             // return list
             return list;
@@ -363,19 +510,19 @@ class RedisHash
 
         QList<NORM2VALUE(Value)> values(QList<NORM2VALUE(Key)> keys)
         {
+            // a bucketed hash reads the fields of every bucket with one round trip
+            if(this->intBuckets > 1) return this->valuesBuckets(keys);
+
             // serialize all keys to QBytearray list and execute hmget command
-            std::list<QByteArray> sKeys;
+            std::vector<QByteArray> sKeys;
+            sKeys.reserve(keys.size());
             for(auto itr = keys.begin(); itr != keys.end(); itr++) {
-                sKeys << TypeSerializer<Key>::serialize(*itr, this->binarizeKey);
+                sKeys.push_back(TypeSerializer<Key>::serialize(*itr, this->binarizeKey));
             }
-            std::list<QByteArray> sValues = this->redisServer->hmget(this->list, sKeys, RedisServer::RequestType::Syncron)->response()->array();
 
-            // deserialize values to Value Type and append it to values list
+            // the values are decoded directly into the values list
             QList<NORM2VALUE(Value)> values;
-            while(sValues.size() > 0) {
-                values.append(TypeSerializer<Value>::deserialize(sValues.front(), this->binarizeValue));
-                sValues.pop_front();
-            }
+            RedisDecoder::hmget<Value>(*this->redisServer, this->list, sKeys, values, this->binarizeValue);
             return values;
         }
 
@@ -385,25 +532,14 @@ class RedisHash
             QMap<NORM2VALUE(Key),NORM2VALUE(Value)> map;
 
             // if fetch chunk size is smaller or equal 0, so exec hgetall
-            std::list<QByteArray> elements;
-            if(fetchChunkSize <= 0) elements.splice(elements.end(), this->redisServer->hgetall(this->list, RedisServer::RequestType::Syncron)->response()->array());
-
-            // otherwise get key values using scan
-            else {
-                int pos = 0;
-                do {
-                    RedisServer::RedisResponse response = this->redisServer->hscan(this->list, QByteArray::number(pos), fetchChunkSize, pattern, RedisServer::RequestType::Syncron)->response();
-                    pos = response->cursor();
-                    elements.splice(elements.end(), response->array());
-                } while(pos);
+            if(fetchChunkSize <= 0 && this->intBuckets == 1) RedisDecoder::hgetall<Key, Value>(*this->redisServer, this->list, map, this->binarizeKey, this->binarizeValue);
+            else if(fetchChunkSize <= 0) {
+                QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::hgetall);
+                for(auto itr = requests.begin(); itr != requests.end(); itr++) this->insertPairs(map, (*itr)->response()->array());
             }
 
-            // deserialize the data
-            for(auto itr = elements.begin(); itr != elements.end();) {
-                QByteArray key = *itr++;
-                QByteArray value = *itr++;
-                map.insert(TypeSerializer<Key>::deserialize(key, this->binarizeKey), TypeSerializer<Value>::deserialize(value, this->binarizeValue));
-            }
+            // otherwise get key values using scan
+            else this->scanBuckets(fetchChunkSize, pattern, RedisDecoder::Pairs<Key, Value, QMap<NORM2VALUE(Key),NORM2VALUE(Value)>>(map, this->binarizeKey, this->binarizeValue));
 
             // return map
             return map;
@@ -415,34 +551,369 @@ class RedisHash
             QHash<NORM2VALUE(Key),NORM2VALUE(Value)> hash;
 
             // if fetch chunk size is smaller or equal 0, so exec hgetall
-            std::list<QByteArray> elements;
-            if(fetchChunkSize <= 0) elements.splice(elements.end(), this->redisServer->hgetall(this->list, RedisServer::RequestType::Syncron)->response()->array());
+            if(fetchChunkSize <= 0 && this->intBuckets == 1) RedisDecoder::hgetall<Key, Value>(*this->redisServer, this->list, hash, this->binarizeKey, this->binarizeValue);
+            else if(fetchChunkSize <= 0) {
+                QList<RedisServer::RedisRequest> requests = this->execBuckets(&RedisServer::hgetall);
+                int size = 0;
+                for(auto itr = requests.begin(); itr != requests.end(); itr++) size += (*itr)->response()->array().size() / 2;
+                hash.reserve(size);
+                for(auto itr = requests.begin(); itr != requests.end(); itr++) this->insertPairs(hash, (*itr)->response()->array());
+            }
 
             // otherwise get key values using scan
+            else this->scanBuckets(fetchChunkSize, pattern, RedisDecoder::Pairs<Key, Value, QHash<NORM2VALUE(Key),NORM2VALUE(Value)>>(hash, this->binarizeKey, this->binarizeValue));
+
+            // return hash
+            return hash;
+        }
+
+        // Streaming iteration (the visitor is called for every field as soon as it's received, and returns false to skip the remaining fields)
+        // Note: the fields are never stored, so hashes of any size are iterated in constant memory (returns false, if a bucket couldn't be read)
+        template<typename Visitor>
+        bool forEach(Visitor visitor)
+        {
+            // keys and values are received alternately, so the key is kept until it's value is received
+            NORM2VALUE(Key) key = {};
+            bool isKey = true;
+            bool proceed = true;
+            for(int i = 0; i < this->intBuckets && proceed; i++) {
+                bool success = RedisDecoder::streamHgetall(*this->redisServer, this->bucketList(i), [&](const char* data, int length) {
+                    if(isKey) key = RedisDecoder::element<Key>(data, length, this->binarizeKey);
+                    else proceed = visitor(key, RedisDecoder::element<Value>(data, length, this->binarizeValue));
+                    isKey = !isKey;
+                    return proceed;
+                });
+                if(!success) return false;
+            }
+            return true;
+        }
+
+        template<typename Visitor>
+        bool forEachKey(Visitor visitor)
+        {
+            bool proceed = true;
+            for(int i = 0; i < this->intBuckets && proceed; i++) {
+                bool success = RedisDecoder::streamHkeys(*this->redisServer, this->bucketList(i), [&](const char* data, int length) {
+                    return proceed = visitor(RedisDecoder::element<Key>(data, length, this->binarizeKey));
+                });
+                if(!success) return false;
+            }
+            return true;
+        }
+
+        template<typename Visitor>
+        bool forEachValue(Visitor visitor)
+        {
+            bool proceed = true;
+            for(int i = 0; i < this->intBuckets && proceed; i++) {
+                bool success = RedisDecoder::streamHvals(*this->redisServer, this->bucketList(i), [&](const char* data, int length) {
+                    return proceed = visitor(RedisDecoder::element<Value>(data, length, this->binarizeValue));
+                });
+                if(!success) return false;
+            }
+            return true;
+        }
+
+#ifdef REDUST_COROUTINES
+        // Coroutine variants (C++20 only), which suspend the awaiting coroutine instead of blocking a socket
+        // Note: this hash has to exist until the awaited operation is done
+        RedisAwaitable<NORM2VALUE(Value)> valueAsync(Key key)
+        {
+            bool binarizeValue = this->binarizeValue;
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            return RedisAwaitable<NORM2VALUE(Value)>(this->redisServer->hget(this->bucketList(sKey), sKey, RedisServer::RequestType::Asyncron),
+                                                     [binarizeValue](RedisServer::RedisRequest request) { return TypeSerializer<Value>::deserialize(request->response()->string(), binarizeValue); });
+        }
+
+        RedisAwaitable<QList<NORM2VALUE(Value)>> valuesAsync(QList<Key> keys)
+        {
+            // a bucketed hash reads the fields of every bucket by an own request (the values are merged, when all of them are finished)
+            bool binarizeValue = this->binarizeValue;
+            if(this->intBuckets > 1) {
+                QList<RedisServer::RedisRequest> requests;
+                QList<QList<int>> positions;
+                this->requestBuckets(keys, RedisServer::RequestType::Asyncron, requests, positions);
+                int count = keys.size();
+                return RedisAwaitable<QList<NORM2VALUE(Value)>>(RedisServer::whenAll(requests),
+                                                                [requests, positions, count, binarizeValue](RedisServer::RedisRequest) {
+                                                                    return RedisHash::mergeBuckets(requests, positions, count, binarizeValue);
+                                                                });
+            }
+
+            // serialize keys
+            std::list<QByteArray> sKeys;
+            for(auto itr = keys.begin(); itr != keys.end(); itr++) {
+                sKeys << TypeSerializer<Key>::serialize(*itr, this->binarizeKey);
+            }
+
+            // deserialize values, when the reply is handled
+            return RedisAwaitable<QList<NORM2VALUE(Value)>>(this->redisServer->hmget(this->list, sKeys, RedisServer::RequestType::Asyncron),
+                                                            [binarizeValue](RedisServer::RedisRequest request) {
+                                                                QList<NORM2VALUE(Value)> values;
+                                                                RedisHash::appendElements<Value>(values, request->response()->array(), 0, 1, binarizeValue);
+                                                                return values;
+                                                            });
+        }
+
+        RedisAwaitable<bool> insertAsync(Key key, Value value, bool replace = true)
+        {
+            QByteArray sKey = TypeSerializer<Key>::serialize(key, this->binarizeKey);
+            RedisServer::RedisRequest request = replace ?
+                this->redisServer->hset(this->bucketList(sKey), sKey, TypeSerializer<Value>::serialize(value, this->binarizeValue), RedisServer::RequestType::Asyncron) :
+                this->redisServer->hsetnx(this->bucketList(sKey), sKey, TypeSerializer<Value>::serialize(value, this->binarizeValue), RedisServer::RequestType::Asyncron);
+            return RedisAwaitable<bool>(request, [](RedisServer::RedisRequest request) { return request->isSuccess() && !request->hasError() && !request->response()->hasError(); });
+        }
+
+        RedisTask<QHash<NORM2VALUE(Key),NORM2VALUE(Value)>> toHashAsync(int fetchChunkSize = -1, QByteArray pattern = "")
+        {
+            // create result data list
+            QHash<NORM2VALUE(Key),NORM2VALUE(Value)> hash;
+
+            // if fetch chunk size is smaller or equal 0, so exec hgetall (on all buckets at once)
+            if(fetchChunkSize <= 0) {
+                QList<RedisServer::RedisRequest> requests;
+                for(int i = 0; i < this->intBuckets; i++) requests.append(this->redisServer->hgetall(this->bucketList(i), RedisServer::RequestType::Asyncron));
+                co_await RedisServer::whenAll(requests);
+                for(auto itr = requests.begin(); itr != requests.end(); itr++) {
+                    RedisServer::RedisResponseArray elements = (*itr)->response()->array();
+                    hash.reserve(hash.size() + elements.size() / 2);
+                    this->insertPairs(hash, elements);
+                }
+            }
+
+            // otherwise get key values using scan (every page is awaited, before the next one is requested)
             else {
+                for(int i = 0; i < this->intBuckets; i++) {
+                    int pos = 0;
+                    do {
+                        RedisServer::RedisRequest request = co_await this->redisServer->hscan(this->bucketList(i), QByteArray::number(pos), fetchChunkSize, pattern, RedisServer::RequestType::Asyncron);
+                        pos = request->response()->cursor();
+                        this->insertPairs(hash, request->response()->reply().at(1).array());
+                    } while(pos);
+                }
+            }
+
+            // return hash
+            co_return hash;
+        }
+#endif
+
+    private:
+        // built-in scripts (they are loaded into the script cache of the server on first use)
+        RedisServer::RedisRequest evalScript(const QByteArray& script, std::list<QByteArray> keys, std::list<QByteArray> args)
+        {
+            return this->redisServer->evalScript(this->redisServer->loadScript(script), keys, args, RedisServer::RequestType::Syncron);
+        }
+        static QByteArray takeScript()
+        {
+            return QByteArrayLiteral("local values = {}\n"
+                                     "for i = 1, #ARGV, 2 do\n"
+                                     "    local list = KEYS[tonumber(ARGV[i])]\n"
+                                     "    values[#values + 1] = redis.call('HGET', list, ARGV[i + 1])\n"
+                                     "    redis.call('HDEL', list, ARGV[i + 1])\n"
+                                     "end\n"
+                                     "return values\n");
+        }
+        static QByteArray compareAndSetScript()
+        {
+            return QByteArrayLiteral("if redis.call('HGET', KEYS[1], ARGV[1]) ~= ARGV[2] then return 0 end\n"
+                                     "redis.call('HSET', KEYS[1], ARGV[1], ARGV[3])\n"
+                                     "return 1\n");
+        }
+        static QByteArray moveScript()
+        {
+            return QByteArrayLiteral("local value = redis.call('HGET', KEYS[1], ARGV[1])\n"
+                                     "if not value then return 0 end\n"
+                                     "if KEYS[1] == KEYS[2] and ARGV[1] == ARGV[2] then return 1 end\n"
+                                     "redis.call('HSET', KEYS[2], ARGV[2], value)\n"
+                                     "redis.call('HDEL', KEYS[1], ARGV[1])\n"
+                                     "return 1\n");
+        }
+
+        // physical hash of a bucket (a hash with one bucket is stored under it's own name)
+        static QByteArray bucketName(const QByteArray& list, int buckets, int bucket)
+        {
+            return buckets == 1 ? list : list + ":" + QByteArray::number(bucket);
+        }
+        QByteArray bucketList(int bucket)
+        {
+            return RedisHash::bucketName(this->list, this->intBuckets, bucket);
+        }
+
+        // bucket of a serialized field (by a stable FNV-1a hash, so that every client finds the field in the same bucket)
+        int bucketOf(const QByteArray& sKey)
+        {
+            if(this->intBuckets == 1) return 0;
+            quint32 hash = 2166136261u;
+            for(int i = 0; i < sKey.size(); i++) hash = (hash ^ (uchar)sKey.at(i)) * 16777619u;
+            return hash % this->intBuckets;
+        }
+        QByteArray bucketList(const QByteArray& sKey)
+        {
+            return this->bucketList(this->bucketOf(sKey));
+        }
+
+        // execute a command on every bucket (syncron with one round trip)
+        QList<RedisServer::RedisRequest> execBuckets(RedisServer::RedisRequest (RedisServer::*command)(QByteArray, RedisServer::RequestType))
+        {
+            QList<RedisServer::RedisRequest> requests;
+            if(this->intBuckets == 1) {
+                requests.append((this->redisServer->*command)(this->list, RedisServer::RequestType::Syncron));
+                return requests;
+            }
+            RedisPipeline batch(*this->redisServer, RedisServer::ConnectionType::Blocked, QByteArray(), this->intBuckets + 1);
+            for(int i = 0; i < this->intBuckets; i++) requests.append(batch.exec(command, this->bucketList(i)));
+            batch.flush();
+            return requests;
+        }
+
+        // scan every bucket page by page (the key/value pairs of every page are decoded directly by the given decoder)
+        template<typename Decoder>
+        void scanBuckets(int fetchChunkSize, const QByteArray& pattern, Decoder decoder)
+        {
+            for(int i = 0; i < this->intBuckets; i++) {
                 int pos = 0;
                 do {
-                    RedisServer::RedisResponse response = this->redisServer->hscan(this->list, QByteArray::number(pos), fetchChunkSize, pattern, RedisServer::RequestType::Syncron)->response();
-                    pos = response->cursor();
-                    elements.splice(elements.end(), response->array());
+                    if(!RedisDecoder::hscan(*this->redisServer, this->bucketList(i), pos, decoder, fetchChunkSize, pattern)) break;
                 } while(pos);
             }
+        }
+
+        // serialize the fields and write every bucket by one HMSET (or insert every field by HSETNX, if they are not replaced)
+        bool insertBuckets(const QList<Key>& keys, const QList<Value>& values, RedisServer::RequestType type, bool replace)
+        {
+            if(!replace) {
+                QList<QByteArray> sKeys, sValues;
+                for(int i = 0; i < keys.size(); i++) {
+                    sKeys.append(TypeSerializer<Key>::serialize(keys.at(i), this->binarizeKey));
+                    sValues.append(TypeSerializer<Value>::serialize(values.at(i), this->binarizeValue));
+                }
+                return this->execFields(sKeys, sValues, type);
+            }
+            QHash<int, std::map<QByteArray, QByteArray>> buckets;
+            for(int i = 0; i < keys.size(); i++) {
+                QByteArray sKey = TypeSerializer<Key>::serialize(keys.at(i), this->binarizeKey);
+                buckets[this->bucketOf(sKey)][sKey] = TypeSerializer<Value>::serialize(values.at(i), this->binarizeValue);
+            }
+            bool success = true;
+            for(auto itr = buckets.begin(); itr != buckets.end(); itr++) success = !this->redisServer->hmset(this->bucketList(itr.key()), itr.value(), type)->hasError() && success;
+            return success;
+        }
 
-            // deserialize the data
-            for(auto itr = elements.begin(); itr != elements.end();) {
-                QByteArray key = *itr++;
-                QByteArray value = *itr++;
-                hash.insert(TypeSerializer<Key>::deserialize(key, this->binarizeKey), TypeSerializer<Value>::deserialize(value, this->binarizeValue));
+        // execute a command per field atomically by one transaction (fields with values are inserted by HSETNX, otherwise they are removed by HDEL)
+        // Note: buckets of a cluster may belong to different slots, so their commands are just batched by a blocked pipeline
+        // Note: only syncron commands are executed atomically, for all other types every field is executed by an own request of this type
+        bool execFields(const QList<QByteArray>& sKeys, const QList<QByteArray>& sValues, RedisServer::RequestType type)
+        {
+            if(sKeys.isEmpty()) return true;
+            if(type != RedisServer::RequestType::Syncron) {
+                bool success = true;
+                for(int i = 0; i < sKeys.size(); i++) {
+                    if(sValues.isEmpty()) success = !this->redisServer->hdel(this->bucketList(sKeys.at(i)), sKeys.at(i), type)->hasError() && success;
+                    else success = !this->redisServer->hsetnx(this->bucketList(sKeys.at(i)), sKeys.at(i), sValues.at(i), type)->hasError() && success;
+                }
+                return success;
+            }
+            if(this->intBuckets == 1 || !this->redisServer->isCluster()) {
+                RedisTransaction transaction(*this->redisServer, this->bucketList(sKeys.front()));
+                this->addFields(transaction, sKeys, sValues);
+                return transaction.commit();
             }
+            RedisPipeline batch(*this->redisServer, RedisServer::ConnectionType::Blocked, QByteArray(), sKeys.size() + 1);
+            QList<RedisServer::RedisRequest> requests = this->addFields(batch, sKeys, sValues);
+            batch.flush();
+            for(auto itr = requests.begin(); itr != requests.end(); itr++) if(!(*itr)->isSuccess() || (*itr)->response()->hasError()) return false;
+            return true;
+        }
+        template<typename Batch>
+        QList<RedisServer::RedisRequest> addFields(Batch& batch, const QList<QByteArray>& sKeys, const QList<QByteArray>& sValues)
+        {
+            QList<RedisServer::RedisRequest> requests;
+            for(int i = 0; i < sKeys.size(); i++) {
+                if(sValues.isEmpty()) requests.append(batch.exec(&RedisServer::hdel, this->bucketList(sKeys.at(i)), sKeys.at(i)));
+                else requests.append(batch.exec(&RedisServer::hsetnx, this->bucketList(sKeys.at(i)), sKeys.at(i), sValues.at(i)));
+            }
+            return requests;
+        }
 
-            // return hash
-            return hash;
+        // group the serialized fields by their bucket (positions contains the index of every field in keys)
+        template<typename Keys>
+        void groupBuckets(const Keys& keys, QList<int>& buckets, QList<std::list<QByteArray>>& sKeys, QList<QList<int>>& positions)
+        {
+            QHash<int, int> indices;
+            int pos = 0;
+            for(auto itr = keys.begin(); itr != keys.end(); itr++, pos++) {
+                QByteArray sKey = TypeSerializer<Key>::serialize(*itr, this->binarizeKey);
+                int bucket = this->bucketOf(sKey);
+                if(!indices.contains(bucket)) {
+                    indices.insert(bucket, buckets.size());
+                    buckets.append(bucket);
+                    sKeys.append(std::list<QByteArray>());
+                    positions.append(QList<int>());
+                }
+                sKeys[indices.value(bucket)].push_back(sKey);
+                positions[indices.value(bucket)].append(pos);
+            }
+        }
+
+        // read the fields of every bucket by one HMGET
+        // Note: syncron requests are written with one round trip
+        template<typename Keys>
+        void requestBuckets(const Keys& keys, RedisServer::RequestType type, QList<RedisServer::RedisRequest>& requests, QList<QList<int>>& positions)
+        {
+            QList<int> buckets;
+            QList<std::list<QByteArray>> sKeys;
+            this->groupBuckets(keys, buckets, sKeys, positions);
+            if(type != RedisServer::RequestType::Syncron) {
+                for(int i = 0; i < buckets.size(); i++) requests.append(this->redisServer->hmget(this->bucketList(buckets.at(i)), sKeys.at(i), type));
+                return;
+            }
+            RedisPipeline batch(*this->redisServer, RedisServer::ConnectionType::Blocked, QByteArray(), buckets.size() + 1);
+            for(int i = 0; i < buckets.size(); i++) requests.append(batch.exec(&RedisServer::hmget, this->bucketList(buckets.at(i)), sKeys.at(i)));
+            batch.flush();
+        }
+
+        // merge the values of all buckets in the order of the requested fields (they are copied out of the receive buffers, which die with the requests)
+        static QList<NORM2VALUE(Value)> mergeBuckets(const QList<RedisServer::RedisRequest>& requests, const QList<QList<int>>& positions, int count, bool binarizeValue)
+        {
+            QList<NORM2VALUE(Value)> values;
+            values.reserve(count);
+            for(int i = 0; i < count; i++) values.append(NORM2VALUE(Value)());
+            for(int i = 0; i < requests.size(); i++) {
+                RedisServer::RedisResponseArray elements = requests.at(i)->response()->array();
+                for(int j = 0; j < elements.size() && j < positions.at(i).size(); j++) values[positions.at(i).at(j)] = RedisDecoder::element<Value>(elements, j, binarizeValue);
+            }
+            return values;
+        }
+        QList<NORM2VALUE(Value)> valuesBuckets(const QList<NORM2VALUE(Key)>& keys)
+        {
+            QList<RedisServer::RedisRequest> requests;
+            QList<QList<int>> positions;
+            this->requestBuckets(keys, RedisServer::RequestType::Syncron, requests, positions);
+            return RedisHash::mergeBuckets(requests, positions, keys.size(), this->binarizeValue);
+        }
+
+        // deserialize every step-th element (beginning at first) out of the receive buffer and append it to list
+        template<typename T>
+        static void appendElements(QList<NORM2VALUE(T)>& list, const RedisServer::RedisResponseArray& elements, int first, int step, bool binarize)
+        {
+            list.reserve(list.size() + elements.size() / step);
+            for(int i = first; i < elements.size(); i += step) list.append(RedisDecoder::element<T>(elements, i, binarize));
+        }
+
+        // deserialize key/value pairs out of the receive buffer and insert them into container
+        // Note: RESP2 replies are flat key/value lists, RESP3 maps are stored the same way (keys and values alternately)
+        template<typename Container>
+        void insertPairs(Container& container, const RedisServer::RedisResponseArray& elements)
+        {
+            for(int i = 0; i + 1 < elements.size(); i += 2) container.insert(RedisDecoder::element<Key>(elements, i, this->binarizeKey), RedisDecoder::element<Value>(elements, i + 1, this->binarizeValue));
         }
 
     private:
         bool binarizeKey;
         bool binarizeValue;
         QByteArray list;
+        int intBuckets = 1;
         RedisServer* redisServer;
 };
 
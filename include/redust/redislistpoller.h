@@ -2,6 +2,7 @@
 #define REDISLISTPOLLER_H
 
 #include <QObject>
+#include <QTimer>
 
 // redis
 #include "typeserializer.h"
@@ -56,10 +57,12 @@ class RedisListPoller : public QObject
         void handleResponse();
         bool acquireSocket();
         void releaseSocket();
+        void handleSocketState();
 
     private:
         // constructor generalizer
         void init(RedisServer &server, std::list<QByteArray> keys, int timeout, PollTimeType pollTimeType = PollTimeType::Forever, PopPosition popPosition = PopPosition::Begin);
+        void retry();
 
         int intTimeout;
         bool suspended = false;
@@ -67,8 +70,12 @@ class RedisListPoller : public QObject
         PopPosition enumPopPosition = PopPosition::Begin;
         std::list<QByteArray> lstKeys;
         RedisServer* server = 0;
-        QTcpSocket* socket = 0;
+        QIODevice* socket = 0;
         RedisServer::RedisRequest currentRequest;
+
+        // reconnect (the pop is issued again with exponential backoff, after the connection was lost)
+        QTimer timerReconnect;
+        int intReconnectAttempts = 0;
 };
 
 #endif // REDISLISTPOLLER_H
@@ -0,0 +1,67 @@
+#ifndef REDISMPSCQUEUE_H
+#define REDISMPSCQUEUE_H
+
+// std lib
+#include <atomic>
+#include <utility>
+
+/*
+ * Redis MPSC Queue
+ * - lock-free queue for multiple producers and a single consumer (non intrusive variant of Dmitry Vyukov's MPSC queue)
+ * - push is wait-free (one atomic exchange), pop never blocks
+ * - pop may report an empty queue, while a producer is between it's exchange and linking it's node,
+ *   so producers have to signal the consumer after push (which then pops the element on the next run)
+ * see: http://www.1024cores.net/home/lock-free-algorithms/queues/non-intrusive-mpsc-node-based-queue
+ */
+template<typename T>
+class RedisMpscQueue
+{
+    public:
+        RedisMpscQueue()
+        {
+            this->tail = new Node;
+            this->head.store(this->tail, std::memory_order_relaxed);
+        }
+        ~RedisMpscQueue()
+        {
+            T value;
+            while(this->pop(value));
+            delete this->tail;
+        }
+
+        // producer side (any thread)
+        void push(T value)
+        {
+            Node* node = new Node;
+            node->value = std::move(value);
+            Node* prev = this->head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_release);
+        }
+
+        // consumer side (only one thread)
+        bool pop(T& value)
+        {
+            // the tail is a stub node, so the next node contains the value
+            Node* tail = this->tail;
+            Node* next = tail->next.load(std::memory_order_acquire);
+            if(!next) return false;
+            value = std::move(next->value);
+            this->tail = next;
+            delete tail;
+            return true;
+        }
+        bool isEmpty() { return !this->tail->next.load(std::memory_order_acquire); }
+
+    private:
+        struct Node
+        {
+            std::atomic<Node*> next { nullptr };
+            T value;
+        };
+
+        // producers append at head, the consumer removes at tail (on it's own cache line)
+        std::atomic<Node*> head;
+        alignas(64) Node* tail;
+};
+
+#endif // REDISMPSCQUEUE_H
@@ -0,0 +1,84 @@
+#ifndef REDISNATIVESOCKET_H
+#define REDISNATIVESOCKET_H
+
+// qt core
+#include <QIODevice>
+#include <QByteArray>
+#include <QString>
+
+// std lib
+#include <utility>
+#include <vector>
+
+class RedisNativePoller;
+
+/*
+ * Redis Native Socket
+ * - linux native transport on a raw non-blocking socket (tcp, or unix domain socket for unix:// servers), which bypasses the qt socket stack
+ * - the device is unbuffered: reads go directly from the kernel into the receive buffer of the parser, writes go directly to the kernel
+ * - readiness is driven by one edge triggered epoll instance per thread, which is watched by a single socket notifier of the event loop
+ * - data, which the kernel doesn't accept instantly, is kept and sent when the socket becomes writable again (bytesWritten is emitted then)
+ * Note: only available on linux (see REDUST_NATIVE_TRANSPORT)
+ */
+class RedisNativeSocket : public QIODevice
+{
+    Q_OBJECT
+    public:
+        enum class State {
+            Unconnected,
+            Connecting,
+            Connected
+        };
+
+        // con/deconstructors
+        RedisNativeSocket(QObject* parent = 0);
+        ~RedisNativeSocket();
+
+        // connection handling (the connection is established asyncron, data written in the meantime is sent as soon as the socket is connected)
+        bool connectToServer(const QString& host, quint16 port, OpenMode mode = ReadWrite);
+        void disconnectFromServer();
+        inline State state() { return this->enumState; }
+        bool waitForConnected(int msecs = 30000);
+
+        // QIODevice interface
+        bool isSequential() const override { return true; }
+        qint64 bytesAvailable() const override;
+        qint64 bytesToWrite() const override;
+        bool waitForReadyRead(int msecs) override;
+        bool waitForBytesWritten(int msecs) override;
+        void close() override;
+
+        // gather write of multiple segments with one system call
+        qint64 writeSegments(const std::vector<std::pair<const char*, qint64>>& segments);
+
+    signals:
+        void stateChanged();
+
+    protected:
+        qint64 readData(char* data, qint64 maxSize) override;
+        qint64 writeData(const char* data, qint64 size) override;
+        bool event(QEvent* event) override;
+
+    private slots:
+        void registerPoller();
+        void emitStateChanged();
+
+    private:
+        friend class RedisNativePoller;
+        void handleEvents(quint32 events);
+        bool sendPending();
+        bool finishConnect();
+        bool waitFor(short events, int msecs);
+        void updatePoller();
+        void abort(bool queued = false);
+
+        int fd = -1;
+        State enumState = State::Unconnected;
+        RedisNativePoller* poller = 0;
+
+        // data, which couldn't be sent instantly
+        QByteArray bufferPending;
+        int intPendingPos = 0;
+};
+
+#endif // REDISNATIVESOCKET_H
@@ -0,0 +1,82 @@
+#ifndef REDISPIPELINE_H
+#define REDISPIPELINE_H
+
+// redust
+#include "redust/redisserver.h"
+
+// std lib
+#include <utility>
+
+/*
+ * Redis Pipeline
+ * - independent batch of requests with it's own output buffer, bound to one read/write connection of the server
+ * - requests are written on flush (or automatically, if the batch exceeds maxCommands or maxBytes)
+ * - a syncron flush only waits for the replies of this pipeline, not for every pending request of the server
+ * - a blocked pipeline writes it's batch to a blocked socket and parses all replies syncron on every flush (see RedisServer::execRedisCommands)
+ * - a pipeline of a cluster is split into one pipeline per node, every request keeps it's own reply (so the replies stay in the order of the requests)
+ * Note: a pipeline has to be used in the thread of it's server, unflushed requests are written on destruction
+ */
+class RedisPipeline
+{
+    public:
+        // con/deconstructors (the connection is chosen by the routing key, like every other request of the server)
+        RedisPipeline(RedisServer &server, const QByteArray& routingKey = QByteArray(), int maxCommands = 1024, qint64 maxBytes = 1048576);
+        RedisPipeline(RedisServer &server, RedisServer::ConnectionType type, const QByteArray& routingKey = QByteArray(), int maxCommands = 1024, qint64 maxBytes = 1048576);
+        ~RedisPipeline();
+
+        // add requests (e.g. pipeline.exec(&RedisServer::hset, list, key, value))
+        RedisServer::RedisRequest exec(const RedisServer::RedisCommand& cmd);
+        RedisServer::RedisRequest exec(const std::list<QByteArray>& cmd);
+        template<typename... Params, typename... Args>
+        RedisServer::RedisRequest exec(RedisServer::RedisRequest (RedisServer::*command)(Params...), Args&&... args)
+        {
+            // the command of the server is redirected into this pipeline
+            RedisPipeline* previous = this->server->pipelineTarget;
+            this->server->pipelineTarget = this;
+            RedisServer::RedisRequest request = (this->server->*command)(std::forward<Args>(args)..., RedisServer::RequestType::PipeLine);
+            this->server->pipelineTarget = previous;
+            return request;
+        }
+
+        // write all added requests (Syncron waits until all replies of this pipeline are handled, blocked pipelines are always flushed syncron)
+        int flush(RedisServer::RequestType type = RedisServer::RequestType::Asyncron, int msecs = 30000);
+
+        // getter / setter
+        inline RedisServer::ConnectionType type() { return this->enumType; }
+        inline QIODevice* socket() { return this->socketTarget; }
+        inline int count()
+        {
+            int count = this->lstRequests.size();
+            for(auto itr = this->hashNodePipelines.begin(); itr != this->hashNodePipelines.end(); itr++) count += itr.value()->count();
+            return count;
+        }
+        inline qint64 size()
+        {
+            qint64 size = this->encoder.size();
+            for(auto itr = this->hashNodePipelines.begin(); itr != this->hashNodePipelines.end(); itr++) size += itr.value()->size();
+            return size;
+        }
+        inline int maxCommands() { return this->intMaxCommands; }
+        inline void setMaxCommands(int maxCommands) { this->intMaxCommands = maxCommands; }
+        inline qint64 maxBytes() { return this->intMaxBytes; }
+        inline void setMaxBytes(qint64 maxBytes) { this->intMaxBytes = maxBytes; }
+
+    private:
+        RedisServer* server;
+        RedisServer::ConnectionType enumType;
+        QIODevice* socketTarget = 0;
+        RedisCommandEncoder encoder;
+
+        // auto flush thresholds
+        int intMaxCommands;
+        qint64 intMaxBytes;
+
+        // added requests (not written yet), and written requests (until the next syncron flush)
+        QList<RedisServer::RedisRequest> lstRequests;
+        QList<RedisServer::RedisRequest> lstWrittenRequests;
+
+        // pipelines of the nodes of a cluster
+        QHash<RedisServer*, RedisPipeline*> hashNodePipelines;
+};
+
+#endif // REDISPIPELINE_H
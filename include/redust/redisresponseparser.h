@@ -0,0 +1,96 @@
+#ifndef REDISRESPONSEPARSER_H
+#define REDISRESPONSEPARSER_H
+
+// std lib
+#include <vector>
+
+// qt core
+#include <QIODevice>
+
+// redust
+#include "redust/redisserver.h"
+
+/*
+ * Redis Response Parser
+ * - resumable RESP parser with an own, growable receive buffer per connection
+ * - reads all available data of a device in one call and parses as many replies as possible
+ * - never blocks: if a reply is not complete, the parsing state is kept until more data is available
+ * - understands RESP2 and RESP3, push frames are parsed into an own response (so they never complete a request)
+ */
+class RedisResponseParser
+{
+    public:
+        enum class Result {
+            Incomplete,
+            Complete,
+            Push,
+            ProtocolError
+        };
+
+        RedisResponseParser(int initialBufferSize = 16384);
+
+        // receive buffer handling
+        qint64 readFrom(QIODevice* device);
+        inline bool hasPendingData() { return this->intPos < this->buffer.size(); }
+        inline bool isParsing() { return !this->currentResponse.isNull(); }
+        void reset();
+
+        // parse the next reply into the given response
+        // Note: if Result::Incomplete or Result::Push is returned, the same response has to be passed on the next call
+        Result parse(RedisServer::RedisResponse response);
+
+        // take the last parsed push frame (after Result::Push was returned)
+        RedisServer::RedisResponse takePush();
+
+        // stream the elements of the next reply to the visitor, instead of storing them in the response (only the top level element is stored)
+        // Note: the visitor is dropped, when the reply is complete
+        inline void stream(RedisServer::ElementVisitor visitor) { this->streamVisitor = visitor; this->boolStreamSkipped = false; }
+        inline bool isStreaming() { return (bool)this->streamVisitor; }
+
+    private:
+        // parser helper
+        bool isTopLevel();
+        Result elementFinished();
+        int appendElement(char type, int offset, int length);
+        void visitElement(const char* data, int length);
+        inline bool isStreamed() { return this->streamVisitor && !this->boolPush; }
+        static inline qint64 parseInteger(const char* begin, const char* end)
+        {
+            bool negative = begin != end && *begin == '-';
+            if(negative) begin++;
+            qint64 value = 0;
+            while(begin != end) value = value * 10 + (*begin++ - '0');
+            return negative ? -value : value;
+        }
+
+        // receive buffer
+        // Note: the buffer is shared with all responses parsed out of it, so it's never modified while it's shared
+        QByteArray buffer;
+        int intInitialBufferSize;
+        int intPos = 0;
+        int intReplyPos = 0;
+
+        // parsing state of the current reply
+        // Note: every unfinished array has a pending element counter and the index of it's node in the reply tree
+        struct PendingArray
+        {
+            int elements;
+            int node;
+            bool attribute;
+        };
+        RedisServer::RedisResponse currentResponse;
+        std::vector<PendingArray> lstPendingArrays;
+        int intPendingBulkLength = -1;
+        char charPendingBulkType = '$';
+
+        // push frame handling
+        bool boolPush = false;
+        RedisServer::RedisResponse lastPush;
+
+        // streamed reply (a skipped stream drains the remaining elements without visiting them)
+        RedisServer::ElementVisitor streamVisitor;
+        bool boolStreamSkipped = false;
+        int intMaxStreamRead = 65536;
+};
+
+#endif // REDISRESPONSEPARSER_H
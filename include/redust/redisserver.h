@@ -2,9 +2,38 @@
 #define REDISMAPCONNECTIONMANAGER_H
 
 #include <QTcpSocket>
+#include <QLocalSocket>
 #include <QQueue>
 #include <QEventLoop>
-
+#include <QHash>
+#include <QSharedPointer>
+#include <QPointer>
+#include <QThread>
+#include <QMutex>
+#include <QSemaphore>
+#include <QTimer>
+#include <QElapsedTimer>
+
+// redust
+#include "rediscommandencoder.h"
+#include "redisclientcache.h"
+#include "redismpscqueue.h"
+#ifdef REDUST_NATIVE_TRANSPORT
+#include "redisnativesocket.h"
+#endif
+
+// std lib
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <iterator>
+#include <list>
+#include <vector>
+
+class RedisResponseParser;
+class RedisPipeline;
+class RedisTransaction;
 class RedisServer : public QObject
 {
     Q_OBJECT
@@ -17,11 +46,229 @@ class RedisServer : public QObject
             PipeLine
         };
 
+        enum class Protocol {
+            RESP2 = 2,
+            RESP3 = 3
+        };
+
+        enum class Transport {
+            Qt,
+            Native
+        };
+
+        /*
+         * Redis Response Element
+         * - node of the reply tree of a response, all nodes of a response are stored in pre-order in one contiguous arena
+         * - offset and length describe the payload inside of the receive buffer (length is -1 for null values and the child count for aggregates)
+         * - maps and attributes have two children per entry (key and value), an attribute additionally has the attributed element as last child
+         * - next is the index of the node behind this node's subtree (so it's the next sibling of this node)
+         */
+        struct RedisResponseElement
+        {
+            char type;
+            int offset;
+            int length;
+            int next;
+        };
+
+        /*
+         * Redis Response Array
+         * - lightweight view on the elements of a flat array of a response (keeps the response and it's receive buffer alive)
+         * - elements are only copied out of the receive buffer on demand
+         */
+        struct RedisResponseData;
+        class RedisResponseArray
+        {
+            public:
+                class const_iterator
+                {
+                    public:
+                        typedef std::forward_iterator_tag iterator_category;
+                        typedef QByteArray value_type;
+                        typedef int difference_type;
+                        typedef const QByteArray* pointer;
+                        typedef QByteArray reference;
+
+                        const_iterator(const RedisResponseArray* array, int index) : array(array), index(index) { }
+                        QByteArray operator *() const { return this->array->at(this->index); }
+                        const_iterator& operator ++() { this->index++; return *this; }
+                        const_iterator operator ++(int) { const_iterator itr = *this; this->index++; return itr; }
+                        bool operator ==(const const_iterator& other) const { return this->index == other.index; }
+                        bool operator !=(const const_iterator& other) const { return this->index != other.index; }
+
+                    private:
+                        const RedisResponseArray* array;
+                        int index;
+                };
+
+                RedisResponseArray() { }
+                RedisResponseArray(QSharedPointer<RedisResponseData> response, const char* data, const RedisResponseElement* elements, int size) :
+                    _response(response), _data(data), _elements(elements), _size(size) { }
+
+                // size
+                int size() const { return this->_size; }
+                bool empty() const { return this->_size == 0; }
+
+                // raw element access (without copying the data)
+                bool isNull(int index) const { return this->_elements[index].length == -1; }
+                const char* data(int index) const { return this->_data + this->_elements[index].offset; }
+                int length(int index) const { return this->_elements[index].length; }
+
+                // element access
+                // Note: at() copies the element, rawAt() points directly into the receive buffer (and is only valid as long as this array exists)
+                QByteArray at(int index) const { return this->isNull(index) ? QByteArray() : QByteArray(this->data(index), this->length(index)); }
+                QByteArray rawAt(int index) const { return this->isNull(index) ? QByteArray() : QByteArray::fromRawData(this->data(index), this->length(index)); }
+                QByteArray front() const { return this->at(0); }
+                QByteArray back() const { return this->at(this->_size - 1); }
+
+                // iteration
+                const_iterator begin() const { return const_iterator(this, 0); }
+                const_iterator end() const { return const_iterator(this, this->_size); }
+
+                // convertion
+                std::list<QByteArray> toStdList() const { return std::list<QByteArray>(this->begin(), this->end()); }
+                operator std::list<QByteArray>() const { return this->toStdList(); }
+
+            private:
+                QSharedPointer<RedisResponseData> _response;
+                const char* _data = 0;
+                const RedisResponseElement* _elements = 0;
+                int _size = 0;
+        };
+
+        /*
+         * Redis Reply
+         * - typed view on a node of the reply tree of a response (keeps the response and it's receive buffer alive)
+         * - aggregates (arrays, sets, maps and pushes) can be nested in any depth, child nodes are accessed by at() or by iteration
+         * - attributes are transparent: a reply always points to the attributed element, the attribute map is available by attribute()
+         */
+        class RedisReply
+        {
+            public:
+                class const_iterator
+                {
+                    public:
+                        typedef std::forward_iterator_tag iterator_category;
+                        typedef RedisReply value_type;
+                        typedef int difference_type;
+                        typedef const RedisReply* pointer;
+                        typedef RedisReply reference;
+
+                        const_iterator(const RedisReply* reply, int index) : reply(reply), index(index) { }
+                        RedisReply operator *() const { return RedisReply(this->reply->_response, this->reply->_data, this->reply->_nodes, this->index); }
+                        const_iterator& operator ++() { this->index = this->reply->_nodes[this->index].next; return *this; }
+                        const_iterator operator ++(int) { const_iterator itr = *this; this->operator ++(); return itr; }
+                        bool operator ==(const const_iterator& other) const { return this->index == other.index; }
+                        bool operator !=(const const_iterator& other) const { return this->index != other.index; }
+
+                    private:
+                        const RedisReply* reply;
+                        int index;
+                };
+
+                RedisReply() { }
+                RedisReply(QSharedPointer<RedisResponseData> response, const char* data, const RedisResponseElement* nodes, int index, bool resolveAttribute = true) :
+                    _response(response), _data(data), _nodes(nodes), _index(index)
+                {
+                    // skip attributes, the attributed element is the last child of an attribute
+                    while(resolveAttribute && this->_nodes && this->node().type == '|') {
+                        this->_attribute = this->_index;
+                        int child = this->_index + 1;
+                        for(int i = 0; i < this->node().length; i++) child = this->_nodes[child].next;
+                        this->_index = child;
+                    }
+                }
+
+                // type
+                bool isValid() const { return this->_nodes; }
+                char respType() const { return this->isValid() ? this->node().type : 0; }
+                bool isNull() const { return this->isValid() && this->node().length == -1 && (this->node().type == '$' || this->node().type == '*' || this->node().type == '_'); }
+                bool isString() const { return this->respType() == '$' || this->respType() == '+' || this->respType() == '='; }
+                bool isError() const { return this->respType() == '-' || this->respType() == '!'; }
+                bool isInteger() const { return this->respType() == ':'; }
+                bool isArray() const { return this->respType() == '*'; }
+
+                // RESP3 types
+                bool isBoolean() const { return this->respType() == '#'; }
+                bool isDouble() const { return this->respType() == ','; }
+                bool isBigNumber() const { return this->respType() == '('; }
+                bool isVerbatim() const { return this->respType() == '='; }
+                bool isMap() const { return this->respType() == '%'; }
+                bool isSet() const { return this->respType() == '~'; }
+                bool isPush() const { return this->respType() == '>'; }
+                bool isAttribute() const { return this->respType() == '|'; }
+                bool isAggregate() const { return this->isArray() || this->isMap() || this->isSet() || this->isPush() || this->isAttribute(); }
+
+                // scalar access
+                // Note: string() copies the data, rawString() points directly into the receive buffer (and is only valid as long as this reply exists)
+                QByteArray string() const { return this->isNull() || this->isAggregate() || !this->isValid() ? QByteArray() : QByteArray(this->_data + this->node().offset, this->node().length); }
+                QByteArray rawString() const { return this->isNull() || this->isAggregate() || !this->isValid() ? QByteArray() : QByteArray::fromRawData(this->_data + this->node().offset, this->node().length); }
+                QString error() const { return this->isError() ? QString(this->string()) : QString(); }
+                bool boolean() const { return this->isBoolean() ? this->node().length > 0 && this->_data[this->node().offset] == 't' : this->integer() == 1; }
+                double real() const { return this->isDouble() || this->isString() ? this->rawString().toDouble() : this->integer(); }
+                qint64 integer() const
+                {
+                    if(this->isNull() || this->isAggregate() || !this->isValid()) return 0;
+                    const char* begin = this->_data + this->node().offset;
+                    const char* end = begin + this->node().length;
+                    bool negative = begin != end && *begin == '-';
+                    if(negative) begin++;
+                    qint64 value = 0;
+                    while(begin != end && *begin >= '0' && *begin <= '9') value = value * 10 + (*begin++ - '0');
+                    return negative ? -value : value;
+                }
+
+                // aggregate access
+                // Note: maps have two children per entry, so keys have even and values have odd indices
+                int size() const { return this->isAggregate() && this->node().length > 0 ? this->node().length : 0; }
+                RedisReply at(int index) const
+                {
+                    if(index < 0 || index >= this->size()) return RedisReply();
+                    int node = this->_index + 1;
+                    while(index--) node = this->_nodes[node].next;
+                    return RedisReply(this->_response, this->_data, this->_nodes, node);
+                }
+                const_iterator begin() const { return const_iterator(this, this->isAggregate() ? this->_index + 1 : this->_index); }
+                const_iterator end() const { return const_iterator(this, this->isAggregate() ? this->childrenEnd() : this->_index); }
+
+                // copy of this element as own response, which shares the receive buffer (e.g. for the elements of an EXEC reply)
+                QSharedPointer<RedisResponseData> toResponse() const;
+
+                // attribute of this element (as map of key/value children)
+                RedisReply attribute() const { return this->_attribute == -1 ? RedisReply() : RedisReply(this->_response, this->_data, this->_nodes, this->_attribute, false); }
+
+                // flat array access
+                // Note: this is only valid for aggregates, which don't contain nested aggregates (for maps it contains keys and values alternately)
+                RedisResponseArray array() const
+                {
+                    if(!this->isAggregate()) return RedisResponseArray();
+                    return RedisResponseArray(this->_response, this->_data, this->_nodes + this->_index + 1, this->size());
+                }
+
+            private:
+                const RedisResponseElement& node() const { return this->_nodes[this->_index]; }
+                int childrenEnd() const
+                {
+                    // the attributed element of an attribute is no child of it
+                    if(!this->isAttribute()) return this->node().next;
+                    int child = this->_index + 1;
+                    for(int i = 0; i < this->size(); i++) child = this->_nodes[child].next;
+                    return child;
+                }
+
+                QSharedPointer<RedisResponseData> _response;
+                const char* _data = 0;
+                const RedisResponseElement* _nodes = 0;
+                int _index = 0;
+                int _attribute = -1;
+        };
+
         /*
          * Redis Response Data
          * - contains result data from the redis server
+         * - the whole reply is stored as tree of elements, which point into one shared receive buffer
          */
-        struct RedisResponseData
+        struct RedisResponseData : public QEnableSharedFromThis<RedisResponseData>
         {
             public:
                 enum class Type {
@@ -31,10 +278,18 @@ class RedisServer : public QObject
                     String = 2,
                     Integer = 3,
                     Array = 4,
-                    ArrayList = 5
+
+                    // RESP3 types
+                    Null = 5,
+                    Boolean = 6,
+                    Double = 7,
+                    BigNumber = 8,
+                    Map = 9,
+                    Set = 10,
+                    Push = 11
                 };
 
-                RedisResponseData(QTcpSocket* socket) : _type(RedisResponseData::Type::Okay), _socket(socket) { }
+                RedisResponseData(QIODevice* socket) : _type(RedisResponseData::Type::Okay), _socket(socket) { }
 
                 // Type
                 void type(RedisResponseData::Type type) { this->_type = type; }
@@ -68,55 +323,112 @@ class RedisServer : public QObject
                 // Boolean
                 bool boolean() {
                     return this->_type == RedisResponseData::Type::Integer ? this->integer() == 1 :
+                           this->_type == RedisResponseData::Type::Boolean ? this->integer() == 1 :
                            this->_type == RedisResponseData::Type::String  ? this->string() == "OK" : false;
                 }
+                void boolean(bool boolean)
+                {
+                    this->_type = RedisResponseData::Type::Boolean;
+                    this->_integer = boolean ? 1 : 0;
+                }
 
-                // Array
-                std::list<QByteArray> array() { return this->_array; }
-                std::list<QByteArray>& arrayRef() { return this->_array; }
-                void array(std::list<QByteArray> array)
+                // Double
+                double real() { return this->_type == RedisResponseData::Type::Double ? this->_real : this->_integer; }
+                void real(double real)
                 {
-                    this->_type = RedisResponseData::Type::Array;
-                    this->_array = array;
+                    this->_type = RedisResponseData::Type::Double;
+                    this->_real = real;
                 }
 
-                // Array List
-                std::list<std::list<QByteArray>> arrayList() { return this->_arrayList; }
-                std::list<std::list<QByteArray>>& arrayListRef() { return this->_arrayList; }
-                void arrayList(std::list<std::list<QByteArray>> arrayList)
+                // Reply tree
+                RedisReply reply()
                 {
-                    this->_type = RedisResponseData::Type::ArrayList;
-                    this->_arrayList = arrayList;
+                    if(this->_elements.empty()) return RedisReply();
+                    return RedisReply(this->sharedFromThis(), this->_buffer.constData() + this->_bufferOffset, this->_elements.data(), 0);
                 }
+                std::vector<RedisResponseElement>& elementsRef() { return this->_elements; }
+
+                // Array (elements of a flat top level array)
+                RedisResponseArray array() { return this->reply().array(); }
 
-                // SCAN cursor
-                int cursor() { return this->_cursor; }
-                void cursor(int cursor) { this->_cursor = cursor; }
+                // SCAN cursor (first element of a [|H|S|Z]SCAN reply, the scanned elements are the second element)
+                int cursor() { return this->reply().at(0).integer(); }
+
+                // Receive buffer (all elements are relative to the given offset)
+                void buffer(QByteArray buffer, int offset)
+                {
+                    this->_buffer = buffer;
+                    this->_bufferOffset = offset;
+                }
 
                 // Socket
-                QTcpSocket* socket() { return this->_socket; }
-                void socket(QTcpSocket* socket) { this->_socket = socket; }
+                QIODevice* socket() { return this->_socket; }
+                void socket(QIODevice* socket) { this->_socket = socket; }
+
+                // reset the response for the next reply (the element arena keeps it's capacity, the receive buffer is released)
+                void clear()
+                {
+                    this->_type = RedisResponseData::Type::Okay;
+                    this->_string.clear();
+                    this->_errorString.clear();
+                    this->_integer = -1;
+                    this->_real = 0;
+                    this->buffer(QByteArray(), 0);
+                    this->_elements.clear();
+                }
 
             private:
+                friend class RedisReply;
                 QByteArray _string;
                 QString _errorString;
                 int _integer = -1;
-                std::list<QByteArray> _array;
-                std::list<std::list<QByteArray>> _arrayList;
+                double _real = 0;
+                QByteArray _buffer;
+                int _bufferOffset = 0;
+                std::vector<RedisResponseElement> _elements;
                 Type _type;
-                QTcpSocket* _socket = 0;
-                int _cursor;
+                QIODevice* _socket = 0;
         };
         typedef QSharedPointer<RedisResponseData> RedisResponse;
 
+        // visitor of a streamed reply, which receives every element while it's parsed (length is -1 for null elements)
+        // Note: the data points directly into the receive buffer and is only valid within the call, returning false skips the remaining elements
+        typedef std::function<bool(const char* data, int length)> ElementVisitor;
+
+        /*
+         * Redis Command
+         * - command name and arguments of a redis command
+         * - header contains the pre encoded RESP header, which is either the whole header including the argument count (e.g. "*4\r\n$4\r\nHSET\r\n")
+         *   or just the encoded command name (e.g. "$5\r\nLPUSH\r\n"), if the argument count is variable
+         */
+        struct RedisCommand
+        {
+            RedisCommand(QByteArray name, std::vector<QByteArray> args = std::vector<QByteArray>()) : name(name), args(args) { }
+            RedisCommand(QByteArray header, QByteArray name, std::vector<QByteArray> args) : header(header), name(name), args(args) { }
+
+            // routing key (the first argument, or the first key of a script)
+            QByteArray key() const
+            {
+                if((this->name == "EVALSHA" || this->name == "EVAL") && this->args.size() > 2 && this->args[1] != "0") return this->args[2];
+                return this->args.empty() ? QByteArray() : this->args.front();
+            }
+
+            QByteArray header;
+            QByteArray name;
+            std::vector<QByteArray> args;
+        };
+
         /*
          * Redis Request Data
          * - contains request data from the user
+         * - is the completion handle of it's own reply: it can be waited for, or continued by callbacks (see then)
          */
-        struct RedisRequestData
+        struct RedisRequestData : public QEnableSharedFromThis<RedisRequestData>
         {
-            RedisRequestData(RequestType type, QString error) : _type(type), _response(new RedisResponseData(0)) { this->error(error); }
-            RedisRequestData(RequestType type, QTcpSocket* socket) : _type(type), _response(new RedisResponseData(socket)), _socket(socket) { }
+            typedef std::function<void(QSharedPointer<RedisRequestData>)> Callback;
+
+            RedisRequestData(RequestType type, QString error) : _type(type), _response(new RedisResponseData(0)), _finished(true) { this->error(error); }
+            RedisRequestData(RequestType type, QIODevice* socket) : _type(type), _response(new RedisResponseData(socket)), _socket(socket) { }
 
             // Error
             bool hasError()  { return !this->_errorString.isEmpty() && !this->response()->hasError(); }
@@ -124,7 +436,12 @@ class RedisServer : public QObject
             void error(QString error) { this->_errorString = error; }
 
             // socket
-            QTcpSocket* socket() { return this->_socket; }
+            QIODevice* socket() { return this->_socket; }
+            void socket(QIODevice* socket)
+            {
+                this->_socket = socket;
+                this->_response->socket(socket);
+            }
 
             // response
             RedisResponse response() { return this->_response; }
@@ -142,19 +459,51 @@ class RedisServer : public QObject
             // request type
             RequestType type() { return this->_type; }
 
+            // completion
+            // Note: callbacks are called in the thread of their context object, or directly in the thread which finished the request
+            // Note: if the request is allready finished, then() calls the callback instantly
+            // Note: finish() returns false, if the request was redirected or is allready finished
+            bool isFinished() { return this->_finished.load(std::memory_order_acquire); }
+            bool isSuccess() { return this->isFinished() && this->_success; }
+            void then(Callback callback, QObject* context = 0);
+            bool waitForFinished(int msecs = 30000);
+            bool finish(bool success);
+
             // internal data
             RequestType _type;
             RedisResponse _response;
-            QTcpSocket* _socket = 0;
+            QIODevice* _socket = 0;
             QString _errorString;
             QVariant _customData;
             QByteArray _cmd;
+            std::unique_ptr<RedisCommand> _replay;
+
+            // redirect of cluster requests (returns true, if the request was executed again on another node)
+            std::function<bool(QSharedPointer<RedisRequestData>)> _redirect;
+            int _redirects = 0;
+
+            // completion data
+            struct ContextCallback
+            {
+                Callback callback;
+                QPointer<QObject> context;
+                bool hasContext;
+            };
+            std::atomic<bool> _finished { false };
+            bool _success = false;
+            QThread* _thread = QThread::currentThread();
+            QMutex _mutex;
+            QSemaphore _semaphore;
+            QEventLoop* _eventLoop = 0;
+            std::vector<ContextCallback> _callbacks;
         };
         typedef QSharedPointer<RedisRequestData> RedisRequest;
 
     signals:
         void redisResponseFinished(RedisServer::RedisRequest request, bool success);
         void redisRequestsFinished();
+        void redisPushReceived(RedisServer::RedisResponse push);
+        void redisBackpressure(bool paused);
 
     public:
         enum class ConnectionType {
@@ -163,23 +512,179 @@ class RedisServer : public QObject
             Blocked
         };
 
+        enum class Balancing {
+            LeastInFlight,
+            KeyHash
+        };
+
+        enum class ReadPolicy {
+            Primary,
+            RoundRobin,
+            LeastLatency,
+            ReadYourWrites
+        };
+
+        /*
+         * Queue Stats
+         * - depth of the read/write connections (requests in flight and bytes, which are not sent yet)
+         * - maximums and pauses are counted since the last reset
+         */
+        struct QueueStats
+        {
+            int inFlight = 0;
+            int maxInFlight = 0;
+            qint64 unsentBytes = 0;
+            qint64 maxUnsentBytes = 0;
+            quint64 pauses = 0;
+        };
+
         // Con/Decons
-        RedisServer(QString redisServer = "localhost", qint16 redisPort = 6379);
+        // Note: unix:// servers are connected by unix domain sockets for all connection types (e.g. RedisServer("unix:///var/run/redis.sock"))
+        // Note: the native transport (raw sockets driven by epoll) is only available on linux, otherwise the qt sockets are used
+        RedisServer(QString redisServer = "localhost", qint16 redisPort = 6379, Protocol protocol = Protocol::RESP2, Transport transport = Transport::Qt);
         ~RedisServer();
 
+        // negotiated protocol (RESP3 is requested by HELLO 3 on every new connection)
+        Protocol protocol() { return this->enumProtocol; }
+        Transport transport() { return this->enumTransport; }
+
+        // Socket helpers (sockets are QTcpSockets, or QLocalSockets for unix:// servers, or RedisNativeSockets for the native transport)
+        static bool isConnected(QIODevice* socket);
+        static bool isUnconnected(QIODevice* socket);
+        static bool waitForConnected(QIODevice* socket, int msecs = 30000);
+        template<typename Receiver>
+        static void connectStateChanged(QIODevice* socket, Receiver* receiver, void (Receiver::*slot)())
+        {
+#ifdef REDUST_NATIVE_TRANSPORT
+            RedisNativeSocket* nativeSocket = qobject_cast<RedisNativeSocket*>(socket);
+            if(nativeSocket) {
+                QObject::connect(nativeSocket, &RedisNativeSocket::stateChanged, receiver, slot);
+                return;
+            }
+#endif
+            QLocalSocket* localSocket = qobject_cast<QLocalSocket*>(socket);
+            if(localSocket) QObject::connect(localSocket, &QLocalSocket::stateChanged, receiver, slot);
+            else if(qobject_cast<QAbstractSocket*>(socket)) QObject::connect(qobject_cast<QAbstractSocket*>(socket), &QAbstractSocket::stateChanged, receiver, slot);
+        }
+
         // Redis server connection handling
+        // Note: sockets connect asyncron (initConnections waits for all of them at once), requests are buffered until the socket is connected
         bool initConnections(bool readWrite = true, bool writeOnly = false, int blockedSockets = 1);
-        QTcpSocket* requestConnection(RedisServer::ConnectionType type);
-        void freeBlockedConnection(QTcpSocket *socket);
+        QIODevice* requestConnection(RedisServer::ConnectionType type, const QByteArray& routingKey = QByteArray());
+        void freeBlockedConnection(QIODevice *socket);
+
+        // Read/write connection pool (Asyncron and PipeLine requests are distributed over the pool)
+        // Note: KeyHash pins all requests of a key (the first command argument) to one connection, so they are handled in order
+        int readWriteConnections() { return this->intReadWriteConnections; }
+        void readWriteConnections(int count);
+        Balancing balancing() { return this->enumBalancing; }
+        void balancing(Balancing balancing) { this->enumBalancing = balancing; }
+        int pendingRequestCount();
+
+        // Automatic reconnect of the read/write and write only connections (with exponential backoff after failed attempts)
+        // Note: read only asyncron requests in flight are replayed after a connection loss, all other requests fail with "Connection Lost"
+        void reconnect(bool enabled, int maxBackoff = 10000, bool replay = true);
+        bool isReconnectEnabled() { return this->boolReconnect; }
+
+        // Redis cluster (requests are routed by the hash slot of their key to the connections of the node, which serves the slot)
+        // Note: the slot map is discovered by initConnections, MOVED and ASK redirects are followed and update the slot map
+        // Note: every node is an own server, which takes over the options of this server when it's created (so they have to be set before initConnections)
+        // Note: keyless commands (e.g. PING, KEYS or SCAN) are sent to the node of slot 0, write only requests can't follow redirects
+        void cluster(bool enabled) { this->boolCluster = enabled; }
+        bool isCluster() { return this->boolCluster; }
+        static quint16 hashSlot(const QByteArray& key);
+
+        // Client side sharding over standalone servers (keys are placed on a consistent hash ring, every shard owns virtualNodes points of it)
+        // Note: the server becomes a facade of it's shards, so that requests, hashes and pipelines are routed like the requests of a cluster (it's own host is not used)
+        // Note: hash tags keep related keys on one shard, adding or removing a shard moves only about 1/N of the keys (removed shards keep their connections)
+        void addShard(QString host, qint16 port = 6379, int virtualNodes = 160);
+        void removeShard(QString host, qint16 port = 6379);
+        bool isSharded() { return !this->hashShards.isEmpty(); }
+
+        // Replica reads (read only commands are served by the replicas, all other commands by this server as primary)
+        // Note: ReadYourWrites reads keys, which this client has written within the last window msecs, from the primary (all other keys round robin)
+        // Note: replicas are probed by PING every second (a replica, which doesn't answer, is skipped until it answers again)
+        void addReplica(QString host, qint16 port = 6379);
+        void readPolicy(ReadPolicy policy, int readYourWritesWindow = 1000);
+        ReadPolicy readPolicy() { return this->enumReadPolicy; }
+        static bool isReadOnly(const QByteArray& name);
+
+        // Client side caching of hash fields (kept coherent by CLIENT TRACKING invalidations)
+        // Note: invalidations are received on an own connection, so they are handled as soon as the event loop runs
+        bool enableClientCache(qint64 maxMemory = 67108864);
+        void disableClientCache();
+        RedisClientCache* clientCache() { return this->clientCacheInstance; }
+        QByteArray cachedHget(QByteArray list, QByteArray key);
+
+        // Auto pipelining (asyncron requests of one event loop iteration are written at once per connection)
+        // Note: a connection is written instantly, if it's unwritten requests exceed maxBytes or maxCommands
+        void autoPipelining(bool enabled, qint64 maxBytes = 65536, int maxCommands = 1024);
+        bool isAutoPipelining() { return this->boolAutoPipelining; }
+
+        // Backpressure of asyncron and pipeline requests (redisBackpressure is emitted, when a high watermark is reached and when all low watermarks are reached again)
+        // Note: a watermark of 0 is disabled, writable() returns a request, which finishes as soon as producers may continue
+        void backpressure(int highInFlight, int lowInFlight, qint64 highUnsentBytes = 0, qint64 lowUnsentBytes = 0);
+        bool isPaused() { return this->boolPaused; }
+        RedisRequest writable();
+        QueueStats queueStats();
+        void resetQueueStats();
+
+        // Thread-safe submission of commands (from any thread into the io thread of this server)
+        // Note: while the io thread is running, this server (and it's sockets) belong to it, so other threads must only use submit()
+        // Note: stopped (or destroyed) by the io thread itself, the io thread quits asyncron (a stopped server returns to the thread, which started the io thread)
+        bool startIoThread();
+        void stopIoThread();
+        bool isIoThreadRunning() { return this->threadIo; }
+        RedisRequest submit(const RedisCommand& cmd, RedisRequestData::Callback callback = RedisRequestData::Callback(), QObject* context = 0);
+
+        // Combinators of requests (the returned request finishes, when all or the first of the given requests are finished)
+        // Note: the request of whenAny contains the index of the first finished request as custom data
+        static RedisRequest whenAll(const QList<RedisRequest>& requests);
+        static RedisRequest whenAny(const QList<RedisRequest>& requests);
+        static bool waitForAll(const QList<RedisRequest>& requests, int msecs = 30000) { return RedisServer::whenAll(requests)->waitForFinished(msecs); }
 
         // General Redis Protocol Implementation
-        RedisRequest execRedisCommand(std::list<QByteArray> cmd, RequestType type, QTcpSocket *socket = 0);
-        bool parseResponse(RedisRequest &request);
+        RedisRequest execRedisCommand(const std::list<QByteArray>& cmd, RequestType type, QIODevice *socket = 0);
+        RedisRequest execRedisCommand(const RedisCommand& cmd, RequestType type, QIODevice *socket = 0);
+        // Note: execRedisCommands writes all commands at once to one blocked socket, and parses their replies syncron in order
+        QList<RedisRequest> execRedisCommands(const std::vector<RedisCommand>& cmds, QIODevice *socket = 0);
+        bool parseResponse(RedisRequest &request, bool waitForData = true);
+        // Note: execDecoded executes a command syncron and hands it's reply directly out of the receive buffer to the decoder (see redisdecoder.h)
+        // Note: no request is built, the reply is parsed into a response of the connection, which is reused (so the reply is only valid within the decoder)
+        // Note: execStreamed executes a command syncron and hands the elements of it's reply to the visitor as soon as they are received
+        // Note: the elements aren't stored (and the receive buffer is compacted while the reply is parsed), so replies of any size are consumed in constant memory
+        bool execStreamed(const RedisCommand& cmd, ElementVisitor visitor);
+        template<typename Decoder>
+        bool execDecoded(const RedisCommand& cmd, Decoder&& decoder)
+        {
+            // execute the command on a blocked socket of the node of it's key (or of a replica)
+            QIODevice* socket = 0;
+            RedisServer* node = this->decodingNode(cmd);
+            RedisResponse response = node ? node->executeDecoded(cmd, socket) : RedisResponse();
+            bool success = !response.isNull() && !response->hasError();
+            bool redirected = this->boolCluster && !response.isNull() && response->hasError() && (response->error().startsWith("MOVED ") || response->error().startsWith("ASK "));
+            if(success) decoder(response->reply());
+            if(node) node->releaseDecoded(socket);
+            if(!redirected) return success;
+
+            // redirected commands are executed again as request, which follows the redirect (and updates the slot map)
+            RedisRequest request = this->execRedisCommand(cmd, RequestType::Syncron);
+            if(!request->isSuccess() || request->response()->hasError()) return false;
+            decoder(request->response()->reply());
+            return true;
+        }
+        // Note: executePipeline writes the PipeLine requests of all connections (see RedisPipeline for independent pipelines)
         int executePipeline(RequestType type = RequestType::Syncron);
 
         // General Redis Functions
         RedisRequest ping(QByteArray data = "", RequestType = RequestType::Asyncron);
 
+        // Lua Scripts (a loaded script is cached by SCRIPT LOAD on the server, and executed by it's SHA1 with EVALSHA)
+        // Note: a script, which is missing in the script cache (e.g. after a restart), is executed by EVAL (which caches it again)
+        // Note: loaded scripts are loaded again, whenever a lost connection is reconnected (scripts of transactions are always executed by EVAL)
+        QByteArray loadScript(const QByteArray& script);
+        RedisRequest evalScript(const QByteArray& sha, std::list<QByteArray> keys, std::list<QByteArray> args = std::list<QByteArray>(), RequestType type = RequestType::Syncron);
+
         // Key-Value Redis Functions
         RedisRequest del(QByteArray key, RequestType type = RequestType::Syncron);
         RedisRequest exists(QByteArray key, RequestType type = RequestType::Syncron);
@@ -190,8 +695,8 @@ class RedisServer : public QObject
         RedisRequest lpush(QByteArray key, std::list<QByteArray> values, RequestType type = RequestType::Asyncron);
         RedisRequest rpush(QByteArray key, QByteArray value, RequestType type = RequestType::Asyncron);
         RedisRequest rpush(QByteArray key, std::list<QByteArray> values, RequestType type = RequestType::Asyncron);
-        RedisServer::RedisRequest blpop(QTcpSocket *socket, std::list<QByteArray> lists, int timeout = 0, RequestType type = RequestType::WriteOnly);
-        RedisServer::RedisRequest brpop(QTcpSocket *socket, std::list<QByteArray> lists, int timeout = 0, RequestType type = RequestType::WriteOnly);
+        RedisServer::RedisRequest blpop(QIODevice *socket, std::list<QByteArray> lists, int timeout = 0, RequestType type = RequestType::WriteOnly);
+        RedisServer::RedisRequest brpop(QIODevice *socket, std::list<QByteArray> lists, int timeout = 0, RequestType type = RequestType::WriteOnly);
         RedisRequest llen(QByteArray key, RequestType type = RequestType::Syncron);
 
         // Hash Redis Functions
@@ -216,43 +721,204 @@ class RedisServer : public QObject
         RedisRequest zscan(QByteArray key, QByteArray cursor = "0", int count = -1, QByteArray pattern = "", RequestType type = RequestType::Syncron);
 
     private:
-        RedisRequest scan(QByteArray scanType, QByteArray key, QByteArray cursor, int count, QByteArray pattern, RequestType type);
+        /*
+         * Connection
+         * - per socket receive and send state, including the queues of requests in flight
+         */
+        struct Connection
+        {
+            Connection();
+            ~Connection();
+            void resetParser();
+
+            RedisResponseParser* parser;
+            RedisCommandEncoder encoder;
 
-        // very fast implementation of integer places counting
-        // src: http://stackoverflow.com/a/1068937
-        static inline int numIntPlaces(int n) {
-            if (n < 0) n = (n == INT_MIN) ? INT_MAX : -n;
-            if (n < 10) return 1;
-            if (n < 100) return 2;
-            if (n < 1000) return 3;
-            if (n < 10000) return 4;
-            if (n < 100000) return 5;
-            if (n < 1000000) return 6;
-            if (n < 10000000) return 7;
-            if (n < 100000000) return 8;
-            if (n < 1000000000) return 9;
-            /*      2147483647 is 2^31-1 - add more ifs as needed
-               and adjust this final return as well. */
-            return 10;
+            // protocol handshake (the reply of HELLO is pending, until it's handled by parseHandshake)
+            RedisResponse handshakeResponse;
+            bool boolResp3 = false;
+            int intReconnectAttempts = 0;
+
+            // pipeline data
+            QQueue<RedisServer::RedisRequest> pendingRequests;
+            QQueue<RedisServer::RedisRequest> pendingPipelineRequests;
+            RedisCommandEncoder pipeline;
+
+            // encoded requests, which are not written yet (see deferred flushes and auto pipelining)
+            bool boolFlushPending = false;
+            int intUnflushedCommands = 0;
+
+            // client id of the invalidation connection, the tracking of this connection redirects to (0 if not tracking)
+            qint64 intTrackingRedirect = 0;
+
+            // response, which is reused for the replies of execDecoded
+            RedisResponse decodedResponse;
+        };
+        Connection* connection(QIODevice* socket);
+        QIODevice* connectSocket(RedisServer::ConnectionType type);
+        QIODevice* balanceConnection(const QByteArray& routingKey);
+        void executeRequest(RedisRequest& request, const RedisCommand& cmd, QIODevice* socket);
+        void executeBatch(QList<RedisRequest>& requests, RedisCommandEncoder& encoder, QIODevice* socket);
+        bool parseReply(QIODevice* socket, RedisResponse& response, bool waitForData);
+        RedisServer* decodingNode(const RedisCommand& cmd);
+        RedisResponse executeDecoded(const RedisCommand& cmd, QIODevice*& socket, ElementVisitor visitor = ElementVisitor());
+        void releaseDecoded(QIODevice* socket);
+        void finishRequest(RedisRequest& request, bool success);
+        void flushConnection(QIODevice* socket, Connection* connection);
+        void failPendingRequests(Connection* connection);
+        qint64 unsentBytes();
+        void moveSockets(QThread* thread);
+        void quitIoThread();
+        inline bool isLocal() { return this->strRedisConnectionHost.startsWith("unix://"); }
+        QIODevice* createSocket();
+        void connectToServer(QIODevice* socket, QIODevice::OpenMode mode);
+        void handshake(QIODevice* socket);
+        bool parseHandshake(QIODevice* socket, bool waitForData);
+        void reconnectSocket(QIODevice* socket);
+        bool enableTracking(QIODevice* socket);
+        void drainInvalidations();
+        inline void invalidateClientCache(const QByteArray& key)
+        {
+            RedisServer* server = this->boolCluster ? this->clusterNode(key) : this;
+            if(server && server->clientCacheInstance) server->clientCacheInstance->invalidate(key);
         }
+        void encodeCommand(RedisCommandEncoder& encoder, const RedisCommand& cmd);
+        RedisRequest scan(QByteArray scanType, QByteArray key, QByteArray cursor, int count, QByteArray pattern, RequestType type);
+
+        // child servers (nodes of a cluster and replicas)
+        RedisServer* createChildServer(const QString& host, quint16 port);
+
+        // replicas
+        RedisServer* readReplica(const RedisCommand& cmd);
+        void trackWrite(const RedisCommand& cmd);
+
+        // redis cluster
+        RedisServer* clusterNode(const QByteArray& routingKey);
+        RedisServer* clusterNode(const QString& host, quint16 port);
+        RedisServer* clusterNodeOf(QIODevice* socket);
+        QList<RedisServer*> clusterMasters();
+        bool discoverSlots();
+        bool applySlots(const RedisReply& reply, const QString& defaultHost);
+        void scheduleSlotsRefresh();
+        void executeClusterRequest(RedisRequest& request, const RedisCommand& cmd, QIODevice* socket);
+        void enableRedirect(RedisRequest& request, const RedisCommand& cmd);
+        bool redirectRequest(RedisRequest& request, const RedisCommand& cmd);
+        RedisServer* redirectNode(RedisResponse response, bool& asking);
+        static QByteArray hashTag(const QByteArray& key);
+
+        // lua scripts
+        void enableScriptFallback(RedisRequest& request, const RedisCommand& evalCmd);
+        void reloadScripts(QIODevice* socket);
+
+        // client side sharding
+        void buildShardRing();
+        static quint32 shardHash(const QByteArray& key);
 
     private slots:
         void handleRedisResponse();
+        void handleInvalidation();
+        void drainSubmissions();
+        void flushConnections();
+        void checkBackpressure();
+        void handleSocketState();
+        void handleInvalidationState();
+        void refreshSlots();
+        void probeReplicas();
 
     private:
         // connection queues
-        QTcpSocket* socketWriteOnly = 0;
-        QTcpSocket* socketReadWrite = 0;
-        QQueue<QTcpSocket*> lstBlockedSockets;
+        QIODevice* socketWriteOnly = 0;
+        QList<QIODevice*> lstReadWriteSockets;
+        int intReadWriteConnections = 1;
+        Balancing enumBalancing = Balancing::LeastInFlight;
+        QQueue<QIODevice*> lstBlockedSockets;
+        QHash<QIODevice*, Connection*> hashConnections;
 
         // redis connection data
         QString strRedisConnectionHost;
         quint16 intRedisConnectionPort;
-
-        // pipeline data
-        QQueue<RedisServer::RedisRequest> pendingRequests;
-        QQueue<RedisServer::RedisRequest> pendingPipelineRequests;
-        QByteArray pendingPipelineData;
+        Protocol enumProtocol;
+        Transport enumTransport;
+
+        // reconnect
+        bool boolReconnect = true;
+        bool boolReplay = true;
+        int intReconnectMaxBackoff = 10000;
+
+        // client cache data
+        RedisClientCache* clientCacheInstance = 0;
+        QIODevice* socketInvalidation = 0;
+        qint64 intInvalidationClientId = 0;
+        RedisResponse invalidationResponse;
+
+        // deferred flushes (asyncron requests are written at once per connection by flushConnections)
+        bool boolDeferFlush = false;
+        bool boolFlushScheduled = false;
+        QList<QIODevice*> lstFlushConnections;
+
+        // child servers (they are deleted with this server)
+        QList<RedisServer*> lstChildServers;
+
+        // replicas (with their smoothed round trip in usecs, -1 until the first probe is answered)
+        struct Replica
+        {
+            RedisServer* server;
+            qint64 intLatency = -1;
+            bool boolAvailable = true;
+        };
+        QList<Replica> lstReplicas;
+        int intNextReplica = 0;
+        ReadPolicy enumReadPolicy = ReadPolicy::RoundRobin;
+        int intReadYourWritesWindow = 1000;
+        QHash<QByteArray, qint64> hashRecentWrites;
+        int intRecentWritesPruneSize = 1024;
+        QTimer timerReplicaProbe;
+        QElapsedTimer timerClock;
+
+        // redis cluster (the nodes are keyed by host:port, the slot map points to the node of every hash slot)
+        bool boolCluster = false;
+        QHash<QString, RedisServer*> hashClusterNodes;
+        std::vector<RedisServer*> vecClusterSlots;
+        bool boolSlotsRefreshPending = false;
+
+        // client side sharding (virtual nodes of every shard, and the points of all shards sorted by their hash)
+        QHash<RedisServer*, int> hashShards;
+        std::vector<std::pair<quint32, RedisServer*>> vecShardRing;
+
+        // loaded lua scripts (by their SHA1)
+        QHash<QByteArray, QByteArray> hashScripts;
+
+        // pipeline, which receives the pipeline requests of RedisPipeline::exec
+        friend class RedisPipeline;
+        RedisPipeline* pipelineTarget = 0;
+
+        // transaction, which receives the pipeline requests of RedisTransaction::exec
+        friend class RedisTransaction;
+        RedisTransaction* transactionTarget = 0;
+
+        // auto pipelining
+        bool boolAutoPipelining = false;
+        qint64 intAutoPipeliningMaxBytes = 65536;
+        int intAutoPipeliningMaxCommands = 1024;
+
+        // backpressure watermarks and state
+        int intHighInFlight = 0;
+        int intLowInFlight = 0;
+        qint64 intHighUnsentBytes = 0;
+        qint64 intLowUnsentBytes = 0;
+        bool boolPaused = false;
+        QList<RedisRequest> lstWritableRequests;
+        QueueStats queueStatsData;
+
+        // io thread and submission queue
+        struct Submission
+        {
+            RedisRequest request;
+            RedisCommand cmd = RedisCommand(QByteArray());
+        };
+        QThread* threadIo = 0;
+        RedisMpscQueue<Submission> queueSubmissions;
+        std::atomic<bool> boolDrainScheduled { false };
 };
 
 #endif // REDISMAPCONNECTIONMANAGER_H
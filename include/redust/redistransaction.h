@@ -0,0 +1,73 @@
+#ifndef REDISTRANSACTION_H
+#define REDISTRANSACTION_H
+
+// redust
+#include "redust/redisserver.h"
+
+// std lib
+#include <functional>
+#include <utility>
+
+/*
+ * Redis Transaction
+ * - batch of commands, which is executed atomically: MULTI, all commands and EXEC are written at once on commit
+ * - every command keeps it's own request, which receives it's element of the EXEC reply (so there is one round trip for the whole transaction)
+ * - watched keys abort the commit, if they are modified by anybody else before EXEC (see optimistic for a read-modify-write retry loop)
+ * - a transaction holds one blocked connection of the node of it's routing key, from construction until destruction
+ * Note: all keys of a transaction have to belong to this node (in a cluster to one hash slot, e.g. by hash tags), uncommitted commands are discarded on destruction
+ */
+class RedisTransaction
+{
+    public:
+        typedef std::function<bool(RedisTransaction&)> Body;
+
+        // con/deconstructors
+        RedisTransaction(RedisServer &server, const QByteArray& routingKey = QByteArray());
+        ~RedisTransaction();
+
+        // watch keys (WATCH is executed instantly, so that reads after it are covered)
+        bool watch(const std::list<QByteArray>& keys);
+
+        // add commands (e.g. transaction.exec(&RedisServer::hset, list, key, value))
+        RedisServer::RedisRequest exec(const RedisServer::RedisCommand& cmd);
+        RedisServer::RedisRequest exec(const std::list<QByteArray>& cmd);
+        template<typename... Params, typename... Args>
+        RedisServer::RedisRequest exec(RedisServer::RedisRequest (RedisServer::*command)(Params...), Args&&... args)
+        {
+            // the command of the server is redirected into this transaction
+            RedisTransaction* previous = this->server->transactionTarget;
+            this->server->transactionTarget = this;
+            RedisServer::RedisRequest request = (this->server->*command)(std::forward<Args>(args)..., RedisServer::RequestType::PipeLine);
+            this->server->transactionTarget = previous;
+            return request;
+        }
+
+        // execute all added commands atomically (returns false, if the transaction was aborted by a watched key or failed)
+        bool commit();
+        void discard();
+
+        // optimistic read-modify-write: watch keys, run body (which reads and adds commands) and commit, until no watched key was modified in between
+        // Note: body may return false to give up (the transaction is discarded then), the routing key is the first key
+        static bool optimistic(RedisServer& server, const std::list<QByteArray>& keys, Body body, int maxRetries = 16);
+
+        // getter
+        inline int count() { return this->lstRequests.size(); }
+        inline bool isAborted() { return this->boolAborted; }
+        inline QIODevice* socket() { return this->socketTarget; }
+
+    private:
+        void fail(const QString& error);
+
+        RedisServer* server;
+        RedisServer* node;
+        QIODevice* socketTarget = 0;
+        RedisCommandEncoder encoder;
+        bool boolWatching = false;
+        bool boolAborted = false;
+
+        // requests of the added commands, and the requests of their QUEUED replies
+        QList<RedisServer::RedisRequest> lstRequests;
+        QList<RedisServer::RedisRequest> lstQueuedRequests;
+};
+
+#endif // REDISTRANSACTION_H
@@ -2,16 +2,32 @@ QT       += core network
 CONFIG   += c++11
 
 SOURCES += $$PWD/src/redisserver.cpp \
+           $$PWD/src/redisresponseparser.cpp \
+           $$PWD/src/rediscommandencoder.cpp \
+           $$PWD/src/redisclientcache.cpp \
+           $$PWD/src/redispipeline.cpp \
+           $$PWD/src/redistransaction.cpp \
            $$PWD/src/redislistpoller.cpp
 
 HEADERS += $$PWD/include/redust/redishash.h \
            $$PWD/include/redust/redisserver.h \
+           $$PWD/include/redust/redisresponseparser.h \
+           $$PWD/include/redust/rediscommandencoder.h \
+           $$PWD/include/redust/redisclientcache.h \
+           $$PWD/include/redust/redispipeline.h \
+           $$PWD/include/redust/redistransaction.h \
+           $$PWD/include/redust/redisdecoder.h \
+           $$PWD/include/redust/redismpscqueue.h \
+           $$PWD/include/redust/rediscoroutine.h \
            $$PWD/include/redust/typeserializer.h \
            $$PWD/include/redust/redislistpoller.h
 
 # Additional helper headers for easy access
 HEADERS += $$PWD/include/redust/RedisHash \
            $$PWD/include/redust/RedisServer \
+           $$PWD/include/redust/RedisPipeline \
+           $$PWD/include/redust/RedisTransaction \
+           $$PWD/include/redust/RedisDecoder \
            $$PWD/include/redust/TypeSerializer
 
 INCLUDEPATH += $$PWD/include
@@ -21,3 +37,17 @@ defined(REDUST_SUPPORT_PROTOBUF,var) {
     DEFINES += "REDISMAP_SUPPORT_PROTOBUF"
     LIBS += -lprotobuf
 }
+
+# coroutine support (co_await-able requests and RedisHash operations need C++20, see rediscoroutine.h)
+defined(REDUST_COROUTINES,var) {
+    CONFIG -= c++11 c++14 c++17
+    CONFIG += c++2a
+    gcc:!clang: QMAKE_CXXFLAGS += -fcoroutines
+}
+
+# native transport (raw sockets driven by epoll)
+linux {
+    DEFINES += REDUST_NATIVE_TRANSPORT
+    SOURCES += $$PWD/src/redisnativesocket.cpp
+    HEADERS += $$PWD/include/redust/redisnativesocket.h
+}
@@ -1,5 +1,7 @@
 # Features (remove or comment out the following lines to disable features!)
 REDUST_SUPPORT_PROTOBUF=1
+# C++20 coroutine support (uncomment to build the co_await-able API)
+#REDUST_COROUTINES=1
 
 # Lib settings
 PROJECTNAME = redust
@@ -6,6 +6,7 @@ CONFIG += c++11
 
 # Features
 REDUST_SUPPORT_PROTOBUF=1
+REDUST_COROUTINES=1
 
 # Google protobuffer Test messages
 HEADERS += test/test.pb.h
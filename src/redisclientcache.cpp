@@ -0,0 +1,145 @@
+#include "redust/redisclientcache.h"
+
+RedisClientCache::RedisClientCache(qint64 maxMemory)
+{
+    this->intMaxMemory = maxMemory;
+}
+
+RedisClientCache::~RedisClientCache()
+{
+    this->clear();
+}
+
+bool RedisClientCache::lookup(const QByteArray& key, const QByteArray& field, QByteArray& value)
+{
+    // find the entry
+    auto itrKey = this->hashEntries.constFind(key);
+    if(itrKey == this->hashEntries.constEnd()) {
+        this->intMisses++;
+        return false;
+    }
+    Entry* entry = itrKey->value(field);
+    if(!entry) {
+        this->intMisses++;
+        return false;
+    }
+
+    // mark it as most recently used
+    if(entry != this->lruHead) {
+        this->unlink(entry);
+        this->pushFront(entry);
+    }
+    this->intHits++;
+    value = entry->value;
+    return true;
+}
+
+void RedisClientCache::insert(const QByteArray& key, const QByteArray& field, const QByteArray& value, quint64 epoch)
+{
+    // don't cache values, which may be invalidated allready
+    if(epoch != this->intEpoch) return;
+
+    // replace an existing entry, otherwise create a new one
+    QHash<QByteArray, Entry*>& fields = this->hashEntries[key];
+    Entry* entry = fields.value(field);
+    if(entry) {
+        this->intMemoryUsage -= this->entrySize(entry);
+        this->unlink(entry);
+        entry->value = value;
+    } else {
+        entry = new Entry { key, field, value, 0, 0 };
+        fields.insert(field, entry);
+        this->intCount++;
+    }
+    this->intMemoryUsage += this->entrySize(entry);
+    this->pushFront(entry);
+
+    // evict least recently used entries until the memory cap is satisfied (but keep the new entry)
+    while(this->intMemoryUsage > this->intMaxMemory && this->lruTail != entry) {
+        this->remove(this->lruTail);
+        this->intEvictions++;
+    }
+}
+
+void RedisClientCache::invalidate(const QByteArray& key)
+{
+    // every invalidation starts a new epoch, so that reads in progress are not cached
+    this->intEpoch++;
+    this->intInvalidations++;
+
+    // redis tracks whole keys, so all cached fields of the hash become invalid
+    auto itrKey = this->hashEntries.find(key);
+    if(itrKey == this->hashEntries.end()) return;
+    QHash<QByteArray, Entry*> fields = *itrKey;
+    this->hashEntries.erase(itrKey);
+    for(auto itr = fields.begin(); itr != fields.end(); itr++) {
+        Entry* entry = itr.value();
+        this->unlink(entry);
+        this->intMemoryUsage -= this->entrySize(entry);
+        this->intCount--;
+        delete entry;
+    }
+}
+
+void RedisClientCache::clear()
+{
+    this->intEpoch++;
+    while(this->lruHead) {
+        Entry* entry = this->lruHead;
+        this->lruHead = entry->next;
+        delete entry;
+    }
+    this->lruTail = 0;
+    this->hashEntries.clear();
+    this->intMemoryUsage = 0;
+    this->intCount = 0;
+}
+
+void RedisClientCache::maxMemory(qint64 maxMemory)
+{
+    this->intMaxMemory = maxMemory;
+    while(this->intMemoryUsage > this->intMaxMemory && this->lruTail) {
+        this->remove(this->lruTail);
+        this->intEvictions++;
+    }
+}
+
+void RedisClientCache::resetStats()
+{
+    this->intHits = 0;
+    this->intMisses = 0;
+    this->intEvictions = 0;
+    this->intInvalidations = 0;
+}
+
+void RedisClientCache::unlink(Entry* entry)
+{
+    if(entry->prev) entry->prev->next = entry->next;
+    else this->lruHead = entry->next;
+    if(entry->next) entry->next->prev = entry->prev;
+    else this->lruTail = entry->prev;
+    entry->prev = entry->next = 0;
+}
+
+void RedisClientCache::pushFront(Entry* entry)
+{
+    entry->prev = 0;
+    entry->next = this->lruHead;
+    if(this->lruHead) this->lruHead->prev = entry;
+    else this->lruTail = entry;
+    this->lruHead = entry;
+}
+
+void RedisClientCache::remove(Entry* entry)
+{
+    // remove entry from lru list and lookup hash (and drop the hash, if it was it's last field)
+    this->unlink(entry);
+    auto itrKey = this->hashEntries.find(entry->key);
+    if(itrKey != this->hashEntries.end()) {
+        itrKey->remove(entry->field);
+        if(itrKey->isEmpty()) this->hashEntries.erase(itrKey);
+    }
+    this->intMemoryUsage -= this->entrySize(entry);
+    this->intCount--;
+    delete entry;
+}
@@ -0,0 +1,105 @@
+#include "redust/rediscommandencoder.h"
+#ifdef REDUST_NATIVE_TRANSPORT
+#include "redust/redisnativesocket.h"
+#endif
+
+RedisCommandEncoder::RedisCommandEncoder(int initialBufferSize, int gatherThreshold)
+{
+    // reserve the output buffer once, so that it keeps it's capacity when it becomes cleared
+    this->buffer.reserve(initialBufferSize);
+    this->intGatherThreshold = gatherThreshold;
+}
+
+void RedisCommandEncoder::beginArray(int count)
+{
+    // *<count>\r\n
+    this->buffer.append('*');
+    this->appendInteger(count);
+    this->buffer.append("\r\n", 2);
+}
+
+void RedisCommandEncoder::appendRaw(const QByteArray& data)
+{
+    this->buffer.append(data);
+}
+
+void RedisCommandEncoder::appendBulk(const QByteArray& data)
+{
+    // null bulk string: $-1\r\n
+    if(data.isNull()) {
+        this->buffer.append("$-1\r\n", 5);
+        return;
+    }
+
+    // bulk string: $<length>\r\n<data>\r\n
+    this->buffer.append('$');
+    this->appendInteger(data.size());
+    this->buffer.append("\r\n", 2);
+
+    // large data is gathered instead of copied into the output buffer
+    if(data.size() >= this->intGatherThreshold) {
+        this->lstGathered.push_back(std::make_pair(this->buffer.size(), data));
+        this->intGatheredSize += data.size();
+    }
+    else this->buffer.append(data);
+    this->buffer.append("\r\n", 2);
+}
+
+qint64 RedisCommandEncoder::flush(QIODevice* device)
+{
+#ifdef REDUST_NATIVE_TRANSPORT
+    // native sockets write the output buffer and all gathered data with one system call
+    RedisNativeSocket* nativeSocket = qobject_cast<RedisNativeSocket*>(device);
+    if(nativeSocket) {
+        std::vector<std::pair<const char*, qint64>> segments;
+        segments.reserve(this->lstGathered.size() * 2 + 1);
+        int start = 0;
+        for(auto itr = this->lstGathered.begin(); itr != this->lstGathered.end(); itr++) {
+            if(itr->first > start) segments.push_back(std::make_pair(this->buffer.constData() + start, (qint64)(itr->first - start)));
+            segments.push_back(std::make_pair(itr->second.constData(), (qint64)itr->second.size()));
+            start = itr->first;
+        }
+        if(this->buffer.size() > start) segments.push_back(std::make_pair(this->buffer.constData() + start, (qint64)(this->buffer.size() - start)));
+        qint64 written = segments.empty() ? 0 : nativeSocket->writeSegments(segments);
+        this->clear();
+        return written;
+    }
+#endif
+
+    // write the output buffer and all gathered data in order
+    qint64 written = 0;
+    qint64 result = 0;
+    int pos = 0;
+    for(auto itr = this->lstGathered.begin(); itr != this->lstGathered.end() && result != -1; itr++) {
+        if(itr->first > pos && (result = device->write(this->buffer.constData() + pos, itr->first - pos)) != -1) written += result;
+        if(result != -1 && (result = device->write(itr->second)) != -1) written += result;
+        pos = itr->first;
+    }
+    if(result != -1 && this->buffer.size() > pos && (result = device->write(this->buffer.constData() + pos, this->buffer.size() - pos)) != -1) written += result;
+
+    // reuse the output buffer
+    this->clear();
+    return result == -1 ? -1 : written;
+}
+
+void RedisCommandEncoder::clear()
+{
+    this->buffer.resize(0);
+    this->lstGathered.clear();
+    this->intGatheredSize = 0;
+}
+
+void RedisCommandEncoder::appendInteger(qint64 value)
+{
+    // write digits backwards into a small stack buffer, and append them at once
+    char digits[21];
+    char* end = digits + sizeof(digits);
+    char* begin = end;
+    quint64 absValue = value < 0 ? 0 - (quint64)value : (quint64)value;
+    do {
+        *--begin = '0' + absValue % 10;
+        absValue /= 10;
+    } while(absValue);
+    if(value < 0) *--begin = '-';
+    this->buffer.append(begin, end - begin);
+}
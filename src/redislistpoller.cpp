@@ -37,7 +37,8 @@ bool RedisListPoller::start()
 
 void RedisListPoller::stop(bool instantly)
 {
-    // to stop instantly we have to free the socket
+    // to stop instantly we have to free the socket (and cancel a pending reconnect)
+    this->timerReconnect.stop();
     if(instantly) this->releaseSocket();
 
     // otherwise we set the suspended flag so that after the next received data we don't start over
@@ -64,12 +65,21 @@ void RedisListPoller::handleResponse()
     // exit if socket is not valid
     if(!this->socket) return;
 
-    // parse result and exit on fail
-    if(!this->server->parseResponse(this->currentRequest) || this->currentRequest->hasError()) return;
-    std::list<QByteArray> result = this->currentRequest->response()->array();
+    // parse all received data and exit if the reply is not complete yet (or on fail)
+    // Note: this never blocks, the rest of an incomplete reply is handled on the next readyRead
+    if(!this->server->parseResponse(this->currentRequest, false) || this->currentRequest->hasError()) return;
+    RedisServer::RedisReply result = this->currentRequest->response()->reply();
 
-    // if no element could be popped, timeout reached
-    if(result.size() == 1 && result.front().isNull()) {
+    // on an error reply (e.g. a MOVED redirect of a cluster) the pop is issued again on a newly acquired socket
+    if(this->currentRequest->response()->hasError()) {
+        this->releaseSocket();
+        this->retry();
+        return;
+    }
+    this->intReconnectAttempts = 0;
+
+    // if no element could be popped (null multi bulk), timeout reached
+    if(result.isNull()) {
         // if user only want to loop until timeout reached, so suspend
         if((this->enumPollTimeType & PollTimeType::UntilTimeout) == PollTimeType::UntilTimeout) this->suspended = true;
         emit this->timeoutReached();
@@ -79,7 +89,7 @@ void RedisListPoller::handleResponse()
     else if(result.size() == 2) {
         // if user only want to loop until first pop, so suspend
         if((this->enumPollTimeType & PollTimeType::UntilFirstPop) == PollTimeType::UntilFirstPop) this->suspended = true;
-        emit this->popped(result.front(), result.back());
+        emit this->popped(result.at(0).string(), result.at(1).string());
     }
 
     // if suspended flag is set, free the socket instantly and don't start over
@@ -95,9 +105,12 @@ bool RedisListPoller::acquireSocket()
     if(this->socket) return true;
 
     // otherwise acquire one (and return false on error)
-    this->socket = this->server->requestConnection(RedisServer::ConnectionType::Blocked);
-    if(this->socket) this->connect(this->socket, &QTcpSocket::readyRead, this, &RedisListPoller::handleResponse);
-    else return false;
+    // Note: all lists of a cluster have to share their hash slot, so the first list chooses the node
+    this->socket = this->server->requestConnection(RedisServer::ConnectionType::Blocked, this->lstKeys.empty() ? QByteArray() : this->lstKeys.front());
+    if(this->socket) {
+        this->connect(this->socket, &QIODevice::readyRead, this, &RedisListPoller::handleResponse);
+        RedisServer::connectStateChanged(this->socket, this, &RedisListPoller::handleSocketState);
+    } else return false;
 
     // socket was successfull acquired
     return true;
@@ -114,10 +127,31 @@ void RedisListPoller::releaseSocket()
     this->socket = 0;
 }
 
+void RedisListPoller::handleSocketState()
+{
+    // a successfull connection resets the backoff
+    if(!this->socket) return;
+    if(RedisServer::isConnected(this->socket)) this->intReconnectAttempts = 0;
+    if(!RedisServer::isUnconnected(this->socket)) return;
+
+    // the pop is lost with it's connection, so issue it again on a new connection (the first attempt is done instantly)
+    this->releaseSocket();
+    if(!this->suspended) this->retry();
+}
+
+void RedisListPoller::retry()
+{
+    // the first attempt is done instantly, the following ones with exponential backoff
+    this->timerReconnect.start(!this->intReconnectAttempts ? 0 : qMin(10000, 100 << qMin(this->intReconnectAttempts - 1, 16)));
+    this->intReconnectAttempts++;
+}
+
 void RedisListPoller::init(RedisServer &server, std::list<QByteArray> keys, int timeout, PollTimeType pollTimeType, PopPosition popPosition)
 {
     // init vars
     this->server = &server;
+    this->timerReconnect.setSingleShot(true);
+    this->connect(&this->timerReconnect, &QTimer::timeout, this, &RedisListPoller::pop);
     this->lstKeys = keys;
     this->intTimeout = timeout;
     this->enumPollTimeType = pollTimeType;
@@ -0,0 +1,391 @@
+#include "redust/redisnativesocket.h"
+
+// qt core
+#include <QEvent>
+#include <QElapsedTimer>
+#include <QHash>
+#include <QSocketNotifier>
+
+// linux
+#include <errno.h>
+#include <fcntl.h>
+#include <netdb.h>
+#include <poll.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+
+/*
+ * Redis Native Poller
+ * - one edge triggered epoll instance per thread for all native sockets of the thread
+ * - the event loop only watches the epoll descriptor, all ready sockets are handled in one batch
+ * - the poller is deleted with the last socket of it's thread
+ */
+class RedisNativePoller : public QObject
+{
+    public:
+        static RedisNativePoller* instance()
+        {
+            if(!RedisNativePoller::current) RedisNativePoller::current = new RedisNativePoller;
+            return RedisNativePoller::current;
+        }
+
+        void watch(RedisNativeSocket* socket, quint32 events)
+        {
+            epoll_event event;
+            event.events = events | EPOLLET;
+            event.data.fd = socket->fd;
+            if(!this->hashSockets.contains(socket->fd)) {
+                this->hashSockets.insert(socket->fd, socket);
+                epoll_ctl(this->fd, EPOLL_CTL_ADD, socket->fd, &event);
+            } else epoll_ctl(this->fd, EPOLL_CTL_MOD, socket->fd, &event);
+        }
+
+        void unwatch(RedisNativeSocket* socket)
+        {
+            if(this->hashSockets.value(socket->fd) != socket) return;
+            this->hashSockets.remove(socket->fd);
+            epoll_ctl(this->fd, EPOLL_CTL_DEL, socket->fd, 0);
+        }
+
+        void release()
+        {
+            // the poller is deleted later, because it may be processing events right now
+            if(--this->intSockets) return;
+            if(RedisNativePoller::current == this) RedisNativePoller::current = 0;
+            this->deleteLater();
+        }
+        void retain() { this->intSockets++; }
+
+    private:
+        RedisNativePoller() : fd(epoll_create1(EPOLL_CLOEXEC)), notifier(fd, QSocketNotifier::Read)
+        {
+            QObject::connect(&this->notifier, &QSocketNotifier::activated, [this]() { this->process(); });
+        }
+        ~RedisNativePoller()
+        {
+            ::close(this->fd);
+        }
+
+        void process()
+        {
+            // handle all ready sockets at once (sockets are looked up by descriptor, so sockets deleted in between are skipped)
+            epoll_event events[64];
+            int count;
+            do {
+                count = epoll_wait(this->fd, events, 64, 0);
+                for(int i = 0; i < count; i++) {
+                    RedisNativeSocket* socket = this->hashSockets.value(events[i].data.fd);
+                    if(socket) socket->handleEvents(events[i].events);
+                }
+            } while(count == 64);
+        }
+
+        static thread_local RedisNativePoller* current;
+        int fd;
+        QSocketNotifier notifier;
+        QHash<int, RedisNativeSocket*> hashSockets;
+        int intSockets = 0;
+};
+thread_local RedisNativePoller* RedisNativePoller::current = 0;
+
+RedisNativeSocket::RedisNativeSocket(QObject* parent) : QIODevice(parent)
+{
+
+}
+
+RedisNativeSocket::~RedisNativeSocket()
+{
+    this->abort();
+    if(this->poller) this->poller->release();
+}
+
+bool RedisNativeSocket::connectToServer(const QString& host, quint16 port, OpenMode mode)
+{
+    // exit if the socket is allready connected (or connecting)
+    if(this->fd != -1) return true;
+    if(!this->isOpen()) this->open(mode | QIODevice::Unbuffered);
+    this->bufferPending.clear();
+    this->intPendingPos = 0;
+
+    // unix domain socket
+    int result;
+    if(host.startsWith("unix://")) {
+        QByteArray path = host.mid(7).toLocal8Bit();
+        sockaddr_un address = {};
+        address.sun_family = AF_UNIX;
+        if(path.size() >= (int)sizeof(address.sun_path) || (this->fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) == -1) {
+            this->abort(true);
+            return false;
+        }
+        memcpy(address.sun_path, path.constData(), path.size());
+        result = ::connect(this->fd, (sockaddr*)&address, sizeof(address));
+    }
+
+    // tcp socket (without delay, because requests are written at once allready)
+    else {
+        addrinfo hints = {};
+        hints.ai_family = AF_UNSPEC;
+        hints.ai_socktype = SOCK_STREAM;
+        addrinfo* addresses = 0;
+        if(getaddrinfo(host.toLocal8Bit().constData(), QByteArray::number(port).constData(), &hints, &addresses) != 0 || !addresses) {
+            this->abort(true);
+            return false;
+        }
+        this->fd = ::socket(addresses->ai_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int noDelay = 1;
+        if(this->fd != -1) setsockopt(this->fd, IPPROTO_TCP, TCP_NODELAY, &noDelay, sizeof(noDelay));
+        result = this->fd == -1 ? -1 : ::connect(this->fd, addresses->ai_addr, addresses->ai_addrlen);
+        freeaddrinfo(addresses);
+    }
+
+    // the connection is established asyncron (a failed connection is reported asyncron as well, like QAbstractSocket does)
+    if(result == -1 && errno != EINPROGRESS && errno != EAGAIN) {
+        this->abort(true);
+        return false;
+    }
+    this->enumState = result == 0 ? State::Connected : State::Connecting;
+    this->registerPoller();
+    this->emitStateChanged();
+    return true;
+}
+
+void RedisNativeSocket::disconnectFromServer()
+{
+    // send pending data as far as possible, before the connection is closed
+    if(this->enumState == State::Connected) this->sendPending();
+    this->abort();
+}
+
+void RedisNativeSocket::close()
+{
+    this->abort();
+    QIODevice::close();
+}
+
+void RedisNativeSocket::abort(bool queued)
+{
+    // close the descriptor and inform the outside world (queued, if the caller doesn't expect a state change)
+    if(this->poller) this->poller->unwatch(this);
+    if(this->fd != -1) ::close(this->fd);
+    this->fd = -1;
+    this->bufferPending.clear();
+    this->intPendingPos = 0;
+    bool changed = this->enumState != State::Unconnected;
+    this->enumState = State::Unconnected;
+    if(queued) QMetaObject::invokeMethod(this, "emitStateChanged", Qt::QueuedConnection);
+    else if(changed) this->emitStateChanged();
+}
+
+void RedisNativeSocket::emitStateChanged()
+{
+    emit this->stateChanged();
+}
+
+qint64 RedisNativeSocket::bytesAvailable() const
+{
+    int available = 0;
+    if(this->fd != -1) ioctl(this->fd, FIONREAD, &available);
+    return available + QIODevice::bytesAvailable();
+}
+
+qint64 RedisNativeSocket::bytesToWrite() const
+{
+    return this->bufferPending.size() - this->intPendingPos;
+}
+
+qint64 RedisNativeSocket::readData(char* data, qint64 maxSize)
+{
+    // read directly from the kernel into the given buffer
+    if(this->fd == -1) return -1;
+    qint64 read = ::recv(this->fd, data, maxSize, 0);
+    if(read == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) return 0;
+    return read;
+}
+
+qint64 RedisNativeSocket::writeData(const char* data, qint64 size)
+{
+    std::vector<std::pair<const char*, qint64>> segments;
+    segments.push_back(std::make_pair(data, size));
+    return this->writeSegments(segments);
+}
+
+qint64 RedisNativeSocket::writeSegments(const std::vector<std::pair<const char*, qint64>>& segments)
+{
+    // exit if the socket is not connected
+    if(this->fd == -1) return -1;
+    qint64 size = 0;
+    for(auto itr = segments.begin(); itr != segments.end(); itr++) size += itr->second;
+
+    // write all segments with one system call, if no data is pending (otherwise the order would break)
+    // Note: the number of segments per call is limited, so larger batches take multiple calls
+    size_t first = 0;
+    qint64 offset = 0;
+    if(this->enumState == State::Connected && this->bytesToWrite() == 0) {
+        while(first < segments.size()) {
+            iovec vectors[64];
+            int count = 0;
+            qint64 batch = 0;
+            for(size_t i = first; i < segments.size() && count < 64; i++, count++) {
+                vectors[count].iov_base = const_cast<char*>(segments[i].first + (i == first ? offset : 0));
+                vectors[count].iov_len = segments[i].second - (i == first ? offset : 0);
+                batch += vectors[count].iov_len;
+            }
+            msghdr message = {};
+            message.msg_iov = vectors;
+            message.msg_iovlen = count;
+            qint64 result = ::sendmsg(this->fd, &message, MSG_NOSIGNAL);
+            if(result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+            if(result == -1) {
+                this->abort(true);
+                return -1;
+            }
+
+            // skip the written segments (a partial written segment is continued at it's offset, a short write means the kernel buffer is full)
+            offset += result;
+            while(first < segments.size() && offset >= segments[first].second) offset -= segments[first++].second;
+            if(result < batch) break;
+        }
+    }
+
+    // keep the rest until the socket is writable again
+    for(size_t i = first; i < segments.size(); i++) this->bufferPending.append(segments[i].first + (i == first ? offset : 0), segments[i].second - (i == first ? offset : 0));
+    if(this->bytesToWrite()) this->updatePoller();
+    return size;
+}
+
+bool RedisNativeSocket::sendPending()
+{
+    // send as much pending data as the kernel accepts
+    while(this->bytesToWrite()) {
+        qint64 result = ::send(this->fd, this->bufferPending.constData() + this->intPendingPos, this->bytesToWrite(), MSG_NOSIGNAL);
+        if(result == -1 && (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)) break;
+        if(result == -1) {
+            this->abort(true);
+            return false;
+        }
+        this->intPendingPos += result;
+        emit this->bytesWritten(result);
+    }
+
+    // reuse the buffer, if all data was sent
+    if(!this->bytesToWrite()) {
+        this->bufferPending.resize(0);
+        this->intPendingPos = 0;
+    }
+    this->updatePoller();
+    return true;
+}
+
+bool RedisNativeSocket::finishConnect()
+{
+    // check the result of the asyncron connect
+    int error = 0;
+    socklen_t length = sizeof(error);
+    if(getsockopt(this->fd, SOL_SOCKET, SO_ERROR, &error, &length) == -1 || error != 0) {
+        this->abort();
+        return false;
+    }
+    this->enumState = State::Connected;
+    this->emitStateChanged();
+    return this->sendPending();
+}
+
+void RedisNativeSocket::handleEvents(quint32 events)
+{
+    // the connection is established, when the socket becomes writable
+    if(this->enumState == State::Connecting && (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && !this->finishConnect()) return;
+
+    // send pending data
+    if(this->enumState == State::Connected && (events & EPOLLOUT) && !this->sendPending()) return;
+
+    // new data is available (edge triggered, so readyRead is emitted once per arrival like QAbstractSocket does)
+    // Note: if the peer closed the connection, the remaining data is handled first
+    if(events & EPOLLIN) emit this->readyRead();
+    if(this->fd != -1 && (events & (EPOLLRDHUP | EPOLLHUP | EPOLLERR)) && !(this->bytesAvailable() > 0)) this->abort();
+}
+
+bool RedisNativeSocket::waitFor(short events, int msecs)
+{
+    // wait for the descriptor without the event loop
+    pollfd descriptor;
+    descriptor.fd = this->fd;
+    descriptor.events = events;
+    int result;
+    while((result = poll(&descriptor, 1, msecs)) == -1 && errno == EINTR);
+    return result > 0;
+}
+
+bool RedisNativeSocket::waitForConnected(int msecs)
+{
+    if(this->enumState != State::Connecting) return this->enumState == State::Connected;
+    return this->waitFor(POLLOUT, msecs) && this->finishConnect();
+}
+
+bool RedisNativeSocket::waitForReadyRead(int msecs)
+{
+    // pending data has to be sent, while waiting for the reply
+    QElapsedTimer timer;
+    timer.start();
+    if(!this->waitForConnected(msecs)) return false;
+    while(this->fd != -1) {
+        int remaining = msecs < 0 ? -1 : qMax(msecs - (int)timer.elapsed(), 0);
+        if(!this->waitFor(POLLIN | (this->bytesToWrite() ? POLLOUT : 0), remaining)) return false;
+        if(this->bytesToWrite() && !this->sendPending()) return false;
+        if(this->bytesAvailable() > 0) return true;
+
+        // readable without data means, that the connection is closed
+        pollfd descriptor = { this->fd, POLLIN, 0 };
+        if(poll(&descriptor, 1, 0) > 0 && (descriptor.revents & (POLLIN | POLLHUP | POLLERR))) {
+            this->abort();
+            return false;
+        }
+    }
+    return false;
+}
+
+bool RedisNativeSocket::waitForBytesWritten(int msecs)
+{
+    // wait until all pending data is sent
+    QElapsedTimer timer;
+    timer.start();
+    if(!this->waitForConnected(msecs)) return false;
+    while(this->fd != -1 && this->bytesToWrite()) {
+        int remaining = msecs < 0 ? -1 : qMax(msecs - (int)timer.elapsed(), 0);
+        if(!this->waitFor(POLLOUT, remaining) || !this->sendPending()) return false;
+    }
+    return this->fd != -1;
+}
+
+void RedisNativeSocket::updatePoller()
+{
+    // writability is only watched, while connecting or while data is pending
+    if(this->poller && this->fd != -1) this->poller->watch(this, EPOLLIN | EPOLLRDHUP | ((this->enumState == State::Connecting || this->bytesToWrite()) ? (quint32)EPOLLOUT : 0u));
+}
+
+void RedisNativeSocket::registerPoller()
+{
+    // every thread has it's own poller
+    if(!this->poller) {
+        this->poller = RedisNativePoller::instance();
+        this->poller->retain();
+    }
+    this->updatePoller();
+}
+
+bool RedisNativeSocket::event(QEvent* event)
+{
+    // the socket is watched by the poller of it's new thread, after it's moved (the queued call is delivered in the new thread)
+    if(event->type() == QEvent::ThreadChange && this->poller) {
+        this->poller->unwatch(this);
+        this->poller->release();
+        this->poller = 0;
+        QMetaObject::invokeMethod(this, "registerPoller", Qt::QueuedConnection);
+    }
+    return QIODevice::event(event);
+}
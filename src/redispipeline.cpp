@@ -0,0 +1,113 @@
+#include "redust/redispipeline.h"
+
+RedisPipeline::RedisPipeline(RedisServer &server, const QByteArray& routingKey, int maxCommands, qint64 maxBytes) : RedisPipeline(server, RedisServer::ConnectionType::ReadWrite, routingKey, maxCommands, maxBytes)
+{
+
+}
+
+RedisPipeline::RedisPipeline(RedisServer &server, RedisServer::ConnectionType type, const QByteArray& routingKey, int maxCommands, qint64 maxBytes)
+{
+    // a blocked socket is only acquired for the time of a flush (a cluster pipeline uses the pipelines of it's nodes)
+    // Note: write only connections never read replies, so they are not supported
+    this->server = &server;
+    this->enumType = type == RedisServer::ConnectionType::Blocked ? type : RedisServer::ConnectionType::ReadWrite;
+    if(this->enumType == RedisServer::ConnectionType::ReadWrite && !server.isCluster()) this->socketTarget = server.requestConnection(RedisServer::ConnectionType::ReadWrite, routingKey);
+    this->intMaxCommands = maxCommands;
+    this->intMaxBytes = maxBytes;
+}
+
+RedisPipeline::~RedisPipeline()
+{
+    // added requests would never be answered otherwise
+    this->flush(RedisServer::RequestType::Asyncron);
+    qDeleteAll(this->hashNodePipelines);
+}
+
+RedisServer::RedisRequest RedisPipeline::exec(const std::list<QByteArray>& cmd)
+{
+    // split the command into name and arguments
+    if(cmd.empty()) return RedisServer::RedisRequest(new RedisServer::RedisRequestData(RedisServer::RequestType::PipeLine, "Empty Command"));
+    return this->exec(RedisServer::RedisCommand(cmd.front(), std::vector<QByteArray>(++cmd.begin(), cmd.end())));
+}
+
+RedisServer::RedisRequest RedisPipeline::exec(const RedisServer::RedisCommand& cmd)
+{
+    // requests of a cluster are added to the pipeline of the node of their key (and follow redirects)
+    if(this->server->isCluster()) {
+        QByteArray key = cmd.key();
+        RedisServer* node = this->server->clusterNode(key);
+        if(!node) return RedisServer::RedisRequest(new RedisServer::RedisRequestData(RedisServer::RequestType::PipeLine, "No Cluster Node"));
+        RedisPipeline*& pipeline = this->hashNodePipelines[node];
+        if(!pipeline) pipeline = new RedisPipeline(*node, this->enumType, key, this->intMaxCommands, this->intMaxBytes);
+        RedisServer::RedisRequest request = pipeline->exec(cmd);
+        this->server->enableRedirect(request, cmd);
+        return request;
+    }
+
+    // check socket
+    bool blocked = this->enumType == RedisServer::ConnectionType::Blocked;
+    RedisServer::RedisRequest request(new RedisServer::RedisRequestData(blocked ? RedisServer::RequestType::Syncron : RedisServer::RequestType::PipeLine, this->socketTarget));
+    request->cmd(cmd.name);
+    if(!blocked && !this->socketTarget) {
+        request->error("No Socket");
+        request->finish(false);
+        return request;
+    }
+
+    // encode RESP request into the output buffer of this pipeline
+    this->server->encodeCommand(this->encoder, cmd);
+    this->lstRequests.append(request);
+
+    // write instantly, if the batch exceeds the thresholds
+    if(this->lstRequests.size() >= this->intMaxCommands || this->encoder.size() >= this->intMaxBytes) this->flush(RedisServer::RequestType::Asyncron);
+    return request;
+}
+
+int RedisPipeline::flush(RedisServer::RequestType type, int msecs)
+{
+    // the pipelines of all nodes are written first, so that all nodes handle them in parallel
+    if(!this->hashNodePipelines.isEmpty()) {
+        int count = 0;
+        for(auto itr = this->hashNodePipelines.begin(); itr != this->hashNodePipelines.end(); itr++) count += itr.value()->flush(type == RedisServer::RequestType::Syncron ? RedisServer::RequestType::Asyncron : type, msecs);
+        if(type != RedisServer::RequestType::Syncron) return count;
+        for(auto itr = this->hashNodePipelines.begin(); itr != this->hashNodePipelines.end(); itr++) {
+            if(itr.value()->flush(type, msecs) == -1) return -1;
+        }
+        return count;
+    }
+
+    // write the batch of a blocked pipeline to a blocked socket and parse all replies
+    int count = this->lstRequests.size();
+    if(this->enumType == RedisServer::ConnectionType::Blocked) {
+        if(!count) return 0;
+        QIODevice* socket = this->server->requestConnection(RedisServer::ConnectionType::Blocked);
+        this->server->executeBatch(this->lstRequests, this->encoder, socket);
+        this->server->freeBlockedConnection(socket);
+        this->lstRequests.clear();
+        return count;
+    }
+
+    // requests, which are allready handled, are not waited for
+    for(int i = this->lstWrittenRequests.size() - 1; i >= 0; i--) {
+        if(this->lstWrittenRequests.at(i)->isFinished()) this->lstWrittenRequests.removeAt(i);
+    }
+
+    // write added requests behind all requests, which the connection has encoded allready (so that the replies keep the order of the pending requests)
+    if(count) {
+        RedisServer::Connection* connection = this->server->connection(this->socketTarget);
+        if(connection->boolFlushPending) this->server->flushConnection(this->socketTarget, connection);
+        for(auto itr = this->lstRequests.begin(); itr != this->lstRequests.end(); itr++) connection->pendingRequests.enqueue(*itr);
+        this->lstWrittenRequests.append(this->lstRequests);
+        this->lstRequests.clear();
+        if(this->encoder.flush(this->socketTarget) == -1) this->server->failPendingRequests(connection);
+        this->server->checkBackpressure();
+    }
+
+    // wait until the data is written, or until all replies of this pipeline are handled
+    if(type == RedisServer::RequestType::WriteOnlyBlocked && count) this->socketTarget->waitForBytesWritten(msecs);
+    else if(type == RedisServer::RequestType::Syncron && !this->lstWrittenRequests.isEmpty()) {
+        if(!RedisServer::waitForAll(this->lstWrittenRequests, msecs)) return -1;
+        this->lstWrittenRequests.clear();
+    }
+    return count;
+}
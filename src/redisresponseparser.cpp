@@ -0,0 +1,243 @@
+#include "redust/redisresponseparser.h"
+
+// std lib
+#include <cstring>
+
+RedisResponseParser::RedisResponseParser(int initialBufferSize)
+{
+    // reserve the receive buffer once, so that it keeps it's capacity when it becomes cleared
+    this->intInitialBufferSize = initialBufferSize;
+    this->buffer.reserve(initialBufferSize);
+}
+
+qint64 RedisResponseParser::readFrom(QIODevice* device)
+{
+    // exit if there is nothing to read
+    qint64 available = device ? device->bytesAvailable() : 0;
+    if(available <= 0) return 0;
+
+    // a streamed reply is read in chunks, so that the receive buffer keeps it's size
+    if(this->streamVisitor) available = qMin(available, (qint64)qMax(this->intInitialBufferSize, this->intMaxStreamRead));
+
+    // determine the data we have to keep (the unparsed data, including the allready parsed part of the current reply)
+    int keepPos = this->isParsing() ? this->intReplyPos : this->intPos;
+    int keepSize = this->buffer.size() - keepPos;
+
+    // if the receive buffer is shared with parsed responses, continue on a new buffer (so the responses stay valid)
+    // Note: only the data we have to keep is copied
+    if(!this->buffer.isDetached()) {
+        QByteArray newBuffer;
+        newBuffer.reserve(qMax((qint64)this->intInitialBufferSize, keepSize + available));
+        newBuffer.append(this->buffer.constData() + keepPos, keepSize);
+        this->buffer = newBuffer;
+    }
+
+    // otherwise remove allready parsed data from the receive buffer
+    else if(keepPos > 0) this->buffer.remove(0, keepPos);
+    this->intPos -= keepPos;
+    this->intReplyPos -= keepPos;
+
+    // read all available data at once directly behind the unparsed data
+    int size = this->buffer.size();
+    this->buffer.resize(size + available);
+    qint64 read = device->read(this->buffer.data() + size, available);
+    this->buffer.resize(size + qMax(read, (qint64)0));
+    return read;
+}
+
+void RedisResponseParser::reset()
+{
+    this->buffer = QByteArray();
+    this->buffer.reserve(this->intInitialBufferSize);
+    this->intPos = 0;
+    this->intReplyPos = 0;
+    this->currentResponse.clear();
+    this->lstPendingArrays.clear();
+    this->intPendingBulkLength = -1;
+    this->boolPush = false;
+    this->lastPush.clear();
+    this->streamVisitor = RedisServer::ElementVisitor();
+}
+
+RedisResponseParser::Result RedisResponseParser::parse(RedisServer::RedisResponse response)
+{
+    /// Parse RESP2/RESP3 Response
+    /// see: http://redis.io/topics/protocol#resp-protocol-description
+    /// see: https://github.com/redis/redis-specifications/blob/master/protocol/RESP3.md
+    if(this->currentResponse.isNull()) {
+        this->currentResponse = response;
+        this->intReplyPos = this->intPos;
+    }
+
+    // parse until the reply is complete or we run out of data
+    // Note: every parsed element becomes a node of the reply tree, top level scalars are additionally stored directly in the response
+    while(true) {
+        const char* data = this->buffer.constData();
+        int size = this->buffer.size();
+        bool topLevel = this->isTopLevel();
+
+        // handle payload of a previous parsed blob header (BulkString, BlobError or VerbatimString)
+        // Note: the payload of verbatim strings starts with the format (e.g. "txt:"), which is not part of the string
+        if(this->intPendingBulkLength != -1) {
+            if(size - this->intPos < this->intPendingBulkLength + 2) return Result::Incomplete;
+            int prefix = this->charPendingBulkType == '=' ? qMin(4, this->intPendingBulkLength) : 0;
+            const char* payload = data + this->intPos + prefix;
+            int payloadLength = this->intPendingBulkLength - prefix;
+            bool streamed = !topLevel && this->isStreamed();
+            if(!streamed) this->appendElement(this->charPendingBulkType, this->intPos + prefix - this->intReplyPos, payloadLength);
+            if(!topLevel);
+            else if(this->charPendingBulkType == '!') this->currentResponse->error(QString(QByteArray(payload, payloadLength)));
+            else this->currentResponse->string(QByteArray(payload, payloadLength));
+            this->intPos += this->intPendingBulkLength + 2;
+            this->intPendingBulkLength = -1;
+            if(streamed) this->visitElement(payload, payloadLength);
+            Result result = this->elementFinished();
+            if(result != Result::Incomplete) return result;
+            continue;
+        }
+
+        // find the end of the next protocol segment
+        const char* segmentBegin = data + this->intPos;
+        const char* segmentEnd = (const char*)memchr(segmentBegin, '\n', size - this->intPos);
+        if(!segmentEnd) return Result::Incomplete;
+        this->intPos = segmentEnd - data + 1;
+
+        // read segment (but without the segment type and end chars \r and \n)
+        char respDataType = *segmentBegin++;
+        if(segmentEnd > segmentBegin && *(segmentEnd - 1) == '\r') segmentEnd--;
+        int segmentOffset = segmentBegin - data - this->intReplyPos;
+        int segmentLength = segmentEnd - segmentBegin;
+
+        // handle base types (SimpleString, Error and Integer)
+        // handle RESP3 base types (Null, Boolean, Double and BigNumber)
+        if(respDataType == '+' || respDataType == '-' || respDataType == ':' || respDataType == '_' || respDataType == '#' || respDataType == ',' || respDataType == '(') {
+            if(!topLevel && this->isStreamed()) this->visitElement(segmentBegin, respDataType == '_' ? -1 : segmentLength);
+            else this->appendElement(respDataType, segmentOffset, respDataType == '_' ? -1 : segmentLength);
+            if(!topLevel);
+            else if(respDataType == '+') this->currentResponse->string(QByteArray(segmentBegin, segmentLength));
+            else if(respDataType == '-') this->currentResponse->error(QString(QByteArray(segmentBegin, segmentLength)));
+            else if(respDataType == ':') this->currentResponse->integer(this->parseInteger(segmentBegin, segmentEnd));
+            else if(respDataType == '_') {
+                this->currentResponse->string(QByteArray());
+                this->currentResponse->type(RedisServer::RedisResponseData::Type::Null);
+            }
+            else if(respDataType == '#') this->currentResponse->boolean(segmentLength > 0 && *segmentBegin == 't');
+            else if(respDataType == ',') this->currentResponse->real(QByteArray(segmentBegin, segmentLength).toDouble());
+            else {
+                this->currentResponse->string(QByteArray(segmentBegin, segmentLength));
+                this->currentResponse->type(RedisServer::RedisResponseData::Type::BigNumber);
+            }
+        }
+
+        // handle BulkString, BlobError and VerbatimString (null bulk strings are complete, otherwise wait for the payload)
+        else if(respDataType == '$' || respDataType == '!' || respDataType == '=') {
+            int length = this->parseInteger(segmentBegin, segmentEnd);
+            if(length >= 0) {
+                this->intPendingBulkLength = length;
+                this->charPendingBulkType = respDataType;
+                continue;
+            }
+            if(!topLevel && this->isStreamed()) this->visitElement(0, -1);
+            else this->appendElement('$', 0, -1);
+            if(topLevel) this->currentResponse->string(QByteArray());
+        }
+
+        // handle Arrays, Sets, Pushes, Maps and Attributes (in any depth)
+        // Note: maps and attributes have two child nodes (key and value) per entry, an attribute has the attributed element as additional last child
+        // Note: the element arena is reserved for all announced elements, but we don't trust huge lengths blindly (and the elements of a streamed reply aren't stored)
+        else if(respDataType == '*' || respDataType == '~' || respDataType == '>' || respDataType == '%' || respDataType == '|') {
+            int length = this->parseInteger(segmentBegin, segmentEnd);
+            if(length > 0 && (respDataType == '%' || respDataType == '|')) length *= 2;
+
+            // a push frame on top level is no reply to a request, so it's parsed into an own response
+            if(respDataType == '>' && topLevel && this->currentResponse->elementsRef().empty()) {
+                this->currentResponse = RedisServer::RedisResponse(new RedisServer::RedisResponseData(response->socket()));
+                this->boolPush = true;
+            }
+
+            int node = this->appendElement(respDataType, segmentOffset, length);
+            if(!topLevel || respDataType == '|');
+            else if(respDataType == '*') this->currentResponse->type(RedisServer::RedisResponseData::Type::Array);
+            else if(respDataType == '~') this->currentResponse->type(RedisServer::RedisResponseData::Type::Set);
+            else if(respDataType == '>') this->currentResponse->type(RedisServer::RedisResponseData::Type::Push);
+            else this->currentResponse->type(RedisServer::RedisResponseData::Type::Map);
+            if(length > 0 || respDataType == '|') {
+                int elementCount = qMax(length, 0) + (respDataType == '|' ? 1 : 0);
+                std::vector<RedisServer::RedisResponseElement>& elements = this->currentResponse->elementsRef();
+                if(!this->isStreamed() && elements.capacity() < elements.size() + elementCount) elements.reserve(qMax(elements.capacity() * 2, elements.size() + qMin(elementCount, 1048576)));
+                this->lstPendingArrays.push_back({ elementCount, node, respDataType == '|' });
+                continue;
+            }
+        }
+
+        // unknown data type, we can't resync with the stream anymore
+        else {
+            this->currentResponse->error(QString("Protocol Error: unknown RESP type '%1'").arg(QString(QByteArray(1, respDataType))));
+            this->reset();
+            return Result::ProtocolError;
+        }
+
+        // the element is complete
+        Result result = this->elementFinished();
+        if(result != Result::Incomplete) return result;
+    }
+}
+
+RedisServer::RedisResponse RedisResponseParser::takePush()
+{
+    RedisServer::RedisResponse push = this->lastPush;
+    this->lastPush.clear();
+    return push;
+}
+
+bool RedisResponseParser::isTopLevel()
+{
+    // the attributed element of a top level attribute is still on top level
+    for(auto itr = this->lstPendingArrays.begin(); itr != this->lstPendingArrays.end(); itr++) {
+        if(!itr->attribute || itr->elements != 1) return false;
+    }
+    return true;
+}
+
+RedisResponseParser::Result RedisResponseParser::elementFinished()
+{
+    // pop all finished arrays
+    // Note: a finished nested array counts as finished element of it's parent array
+    std::vector<RedisServer::RedisResponseElement>& elements = this->currentResponse->elementsRef();
+    while(!this->lstPendingArrays.empty()) {
+        if(--this->lstPendingArrays.back().elements > 0) return Result::Incomplete;
+        elements[this->lstPendingArrays.back().node].next = elements.size();
+        this->lstPendingArrays.pop_back();
+    }
+
+    // the reply is complete, so share the receive buffer with the response (and drop the visitor of a streamed reply)
+    this->currentResponse->buffer(this->buffer, this->intReplyPos);
+    if(!this->boolPush) this->streamVisitor = RedisServer::ElementVisitor();
+
+    // reset state for the next reply (a push frame is kept until it's taken)
+    Result result = Result::Complete;
+    if(this->boolPush) {
+        this->lastPush = this->currentResponse;
+        this->boolPush = false;
+        result = Result::Push;
+    }
+    this->currentResponse.clear();
+    return result;
+}
+
+void RedisResponseParser::visitElement(const char* data, int length)
+{
+    // hand the element to the visitor, it isn't needed anymore afterwards (so it's dropped from the receive buffer on the next read)
+    // Note: the nodes of nested aggregates are still stored (without their elements)
+    if(!this->boolStreamSkipped && !this->streamVisitor(data, length)) this->boolStreamSkipped = true;
+    this->intReplyPos = this->intPos;
+}
+
+int RedisResponseParser::appendElement(char type, int offset, int length)
+{
+    // append node to the reply tree (it's next sibling is the following node, until it's an array with elements)
+    std::vector<RedisServer::RedisResponseElement>& elements = this->currentResponse->elementsRef();
+    int index = elements.size();
+    elements.push_back({ type, offset, length, index + 1 });
+    return index;
+}
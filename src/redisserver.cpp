@@ -1,159 +1,1046 @@
 #include "redust/redisserver.h"
-
-RedisServer::RedisServer(QString redisServer, qint16 redisPort)
+#include "redust/redisresponseparser.h"
+#include "redust/redispipeline.h"
+#include "redust/redistransaction.h"
+
+// qt core
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QSet>
+#include <QCryptographicHash>
+
+// std lib
+#include <algorithm>
+#include <limits>
+#include <memory>
+
+RedisServer::RedisServer(QString redisServer, qint16 redisPort, Protocol protocol, Transport transport)
 {
     this->strRedisConnectionHost = redisServer;
     this->intRedisConnectionPort = redisPort;
+    this->enumProtocol = protocol;
+    this->enumTransport = transport;
+    this->timerClock.start();
+    this->timerReplicaProbe.setParent(this);
+    QObject::connect(&this->timerReplicaProbe, &QTimer::timeout, this, &RedisServer::probeReplicas);
+#ifndef REDUST_NATIVE_TRANSPORT
+    if(transport == Transport::Native) {
+        qWarning("Native transport is not available on this platform, qt sockets are used...");
+        this->enumTransport = Transport::Qt;
+    }
+#endif
 }
 
 RedisServer::~RedisServer()
 {
+    // a server, which is destroyed by it's own io thread (e.g. by deleteLater), keeps it's sockets in that thread (they are deleted with it)
+    if(this->threadIo && QThread::currentThread() == this->threadIo) this->quitIoThread();
+    else this->stopIoThread();
+
+    // deleted sockets must not be reconnected
+    for(auto itr = this->hashConnections.begin(); itr != this->hashConnections.end(); itr++) itr.key()->disconnect(this);
     delete this->socketWriteOnly;
-    delete this->socketReadWrite;
+    qDeleteAll(this->lstReadWriteSockets);
     qDeleteAll(this->lstBlockedSockets);
+    qDeleteAll(this->hashConnections);
+    delete this->socketInvalidation;
+    delete this->clientCacheInstance;
+    qDeleteAll(this->lstChildServers);
 }
 
 bool RedisServer::initConnections(bool readWrite, bool writeOnly, int blockedSockets)
 {
-    // acquire write socket, and exit on fail
-    if(writeOnly && !this->requestConnection(RedisServer::ConnectionType::WriteOnly)) return false;
+    // discover the slot map of a cluster and connect every node, which serves slots
+    if(this->boolCluster) {
+        if(this->vecShardRing.empty() && this->vecClusterSlots.empty() && !this->discoverSlots()) return false;
+        QList<RedisServer*> nodes = this->clusterMasters();
+        for(auto itr = nodes.begin(); itr != nodes.end(); itr++) {
+            if(!(*itr)->initConnections(readWrite, writeOnly, blockedSockets)) return false;
+        }
+        return true;
+    }
+
+    // replicas are connected as well (but a replica, which can't be connected, is just skipped by reads)
+    for(auto itr = this->lstReplicas.begin(); itr != this->lstReplicas.end(); itr++) itr->boolAvailable = itr->server->initConnections(readWrite, false, blockedSockets);
+
+    // acquire write socket and readwrite sockets
+    QList<QIODevice*> sockets;
+    if(writeOnly && this->requestConnection(RedisServer::ConnectionType::WriteOnly)) sockets.append(this->socketWriteOnly);
+    if(readWrite && this->requestConnection(RedisServer::ConnectionType::ReadWrite)) sockets.append(this->lstReadWriteSockets);
 
-    // acquire readwrite socket, and exit on fail
-    if(readWrite && !this->requestConnection(RedisServer::ConnectionType::ReadWrite)) return false;
+    // reserve blockedSockets blocked sockets
+    for(int i = this->lstBlockedSockets.size(); i < blockedSockets; i++) {
+        QIODevice* socket = this->connectSocket(RedisServer::ConnectionType::Blocked);
+        this->lstBlockedSockets.enqueue(socket);
+        sockets.append(socket);
+    }
 
-    // acquire readwrite blockedSockets sockets, and exit on fail
-    for(int i = 0; i < blockedSockets; i++) {
-        if(!this->requestConnection(RedisServer::ConnectionType::Blocked)) return false;
+    // all sockets connect in parallel, so waiting for all of them takes about one round trip (exit on fail)
+    QElapsedTimer timer;
+    timer.start();
+    for(auto itr = sockets.begin(); itr != sockets.end(); itr++) {
+        if(RedisServer::waitForConnected(*itr, qMax(5000 - (int)timer.elapsed(), 1))) continue;
+        qWarning("Cannot connect to Redis Server %s:%i...", qPrintable(this->strRedisConnectionHost), this->intRedisConnectionPort);
+        return false;
     }
 
     // all successfull constructed
     return true;
 }
 
-QTcpSocket* RedisServer::requestConnection(RedisServer::ConnectionType type)
+QIODevice* RedisServer::requestConnection(RedisServer::ConnectionType type, const QByteArray& routingKey)
 {
-    // acquire blocked socket
-    QTcpSocket* socket = 0;
+    // the connections of a cluster belong to the node of the routing key
+    if(this->boolCluster) {
+        RedisServer* node = this->clusterNode(routingKey);
+        return node ? node->requestConnection(type, routingKey) : 0;
+    }
+
+    // acquire blocked socket (sockets, which lost their connection, are dropped)
     if(type == ConnectionType::Blocked) {
-        if(!this->lstBlockedSockets.isEmpty()) return this->lstBlockedSockets.dequeue();
-        socket = new QTcpSocket;
+        while(!this->lstBlockedSockets.isEmpty()) {
+            QIODevice* socket = this->lstBlockedSockets.dequeue();
+            if(!RedisServer::isUnconnected(socket)) return socket;
+            delete this->hashConnections.take(socket);
+            socket->deleteLater();
+        }
+        return this->connectSocket(type);
     }
 
     // acquire write socket
     else if(type == ConnectionType::WriteOnly) {
-        if(this->socketWriteOnly) return socketWriteOnly;
-        socket = this->socketWriteOnly = new QTcpSocket;
+        if(!this->socketWriteOnly) this->socketWriteOnly = this->connectSocket(type);
+        return this->socketWriteOnly;
     }
 
-    // acquire read/write socket
+    // acquire read/write socket out of the pool (the pool is filled up to it's size first)
+    // Note: the sockets connect asyncron, requests are buffered until they are connected
     else if(type == ConnectionType::ReadWrite) {
-        if(this->socketReadWrite) return socketReadWrite;
-        socket = this->socketReadWrite = new QTcpSocket;
-        QObject::connect(this->socketReadWrite, &QTcpSocket::readyRead, this, &RedisServer::handleRedisResponse);
+        while(this->lstReadWriteSockets.size() < this->intReadWriteConnections) {
+            QIODevice* socket = this->connectSocket(type);
+            QObject::connect(socket, &QIODevice::readyRead, this, &RedisServer::handleRedisResponse);
+            QObject::connect(socket, &QIODevice::bytesWritten, this, &RedisServer::checkBackpressure);
+            this->lstReadWriteSockets.append(socket);
+        }
+        return this->balanceConnection(routingKey);
     }
 
-    // if we have no socket, exit
-    if(!socket) return 0;
+    // unknown connection type
+    return 0;
+}
+
+QIODevice* RedisServer::connectSocket(RedisServer::ConnectionType type)
+{
+    // connect asyncron, data written in the meantime is sent as soon as the socket is connected
+    // Note: syncron requests wait for the connection while they wait for their reply
+    QIODevice* socket = this->createSocket();
+    this->connectToServer(socket, type == ConnectionType::WriteOnly ? QIODevice::WriteOnly : QIODevice::ReadWrite);
+
+    // negotiate the protocol (a write only socket never reads replies, so it doesn't care about the protocol)
+    if(type != ConnectionType::WriteOnly) this->handshake(socket);
+
+    // read/write and write only connections are reconnected automatically
+    if(type != ConnectionType::Blocked) RedisServer::connectStateChanged(socket, this, &RedisServer::handleSocketState);
+    return socket;
+}
+
+QIODevice* RedisServer::createSocket()
+{
+#ifdef REDUST_NATIVE_TRANSPORT
+    if(this->enumTransport == Transport::Native) return new RedisNativeSocket;
+#endif
+    return this->isLocal() ? (QIODevice*)new QLocalSocket : (QIODevice*)new QTcpSocket;
+}
+
+void RedisServer::connectToServer(QIODevice* socket, QIODevice::OpenMode mode)
+{
+#ifdef REDUST_NATIVE_TRANSPORT
+    // native sockets handle unix:// servers on their own, and buffer data while connecting
+    RedisNativeSocket* nativeSocket = qobject_cast<RedisNativeSocket*>(socket);
+    if(nativeSocket) {
+        nativeSocket->connectToServer(this->strRedisConnectionHost, this->intRedisConnectionPort, mode);
+        return;
+    }
+#endif
+
+    // unix domain sockets connect instantly, so they are connected syncron (a connecting QLocalSocket can't buffer data)
+    QLocalSocket* localSocket = qobject_cast<QLocalSocket*>(socket);
+    if(!localSocket) qobject_cast<QTcpSocket*>(socket)->connectToHost(this->strRedisConnectionHost, this->intRedisConnectionPort, mode);
+    else {
+        localSocket->connectToServer(this->strRedisConnectionHost.mid(7), mode);
+        if(localSocket->state() == QLocalSocket::ConnectingState) localSocket->waitForConnected(5000);
+    }
+}
+
+bool RedisServer::isConnected(QIODevice* socket)
+{
+#ifdef REDUST_NATIVE_TRANSPORT
+    RedisNativeSocket* nativeSocket = qobject_cast<RedisNativeSocket*>(socket);
+    if(nativeSocket) return nativeSocket->state() == RedisNativeSocket::State::Connected;
+#endif
+    QLocalSocket* localSocket = qobject_cast<QLocalSocket*>(socket);
+    if(localSocket) return localSocket->state() == QLocalSocket::ConnectedState;
+    QAbstractSocket* tcpSocket = qobject_cast<QAbstractSocket*>(socket);
+    return tcpSocket && tcpSocket->state() == QAbstractSocket::ConnectedState;
+}
+
+bool RedisServer::isUnconnected(QIODevice* socket)
+{
+#ifdef REDUST_NATIVE_TRANSPORT
+    RedisNativeSocket* nativeSocket = qobject_cast<RedisNativeSocket*>(socket);
+    if(nativeSocket) return nativeSocket->state() == RedisNativeSocket::State::Unconnected;
+#endif
+    QLocalSocket* localSocket = qobject_cast<QLocalSocket*>(socket);
+    if(localSocket) return localSocket->state() == QLocalSocket::UnconnectedState;
+    QAbstractSocket* tcpSocket = qobject_cast<QAbstractSocket*>(socket);
+    return !tcpSocket || tcpSocket->state() == QAbstractSocket::UnconnectedState;
+}
 
-    // socket not connected at this point, so let us blocked syncronly connect
-    socket->connectToHost(this->strRedisConnectionHost, this->intRedisConnectionPort, type == ConnectionType::WriteOnly ? QIODevice::WriteOnly : QIODevice::ReadWrite);
-    if(!socket->waitForConnected(5000)) {
-        qFatal("Cannot connect to Redis Server %s:%i, give up...", qPrintable(this->strRedisConnectionHost), this->intRedisConnectionPort);
+bool RedisServer::waitForConnected(QIODevice* socket, int msecs)
+{
+    if(RedisServer::isConnected(socket)) return true;
+#ifdef REDUST_NATIVE_TRANSPORT
+    RedisNativeSocket* nativeSocket = qobject_cast<RedisNativeSocket*>(socket);
+    if(nativeSocket) return nativeSocket->waitForConnected(msecs);
+#endif
+    QLocalSocket* localSocket = qobject_cast<QLocalSocket*>(socket);
+    if(localSocket) return localSocket->waitForConnected(msecs);
+    QAbstractSocket* tcpSocket = qobject_cast<QAbstractSocket*>(socket);
+    return tcpSocket && tcpSocket->waitForConnected(msecs);
+}
 
-        // cleanup blocked socket
-        if(type == ConnectionType::Blocked) delete socket;
-        return 0;
+void RedisServer::handleSocketState()
+{
+    // a successfull connection resets the backoff
+    QIODevice* socket = qobject_cast<QIODevice*>(this->sender());
+    if(!socket) return;
+    Connection* connection = this->connection(socket);
+    if(RedisServer::isConnected(socket)) connection->intReconnectAttempts = 0;
+    if(!RedisServer::isUnconnected(socket)) return;
+
+    // the state of the lost connection is dropped (including not written requests)
+    QQueue<RedisServer::RedisRequest> requests = connection->pendingRequests;
+    connection->pendingRequests.clear();
+    connection->encoder.clear();
+    connection->boolFlushPending = false;
+    connection->intUnflushedCommands = 0;
+    connection->resetParser();
+
+    // read only requests are replayed after the first reconnect attempt, all other requests fail fast
+    // Note: if the first reconnect attempt fails, the replayed requests fail as well (so that nothing waits for the end of an outage)
+    bool replay = this->boolReconnect && this->boolReplay && !connection->intReconnectAttempts;
+    QList<RedisServer::RedisRequest> failedRequests;
+    for(auto itr = requests.begin(); itr != requests.end(); itr++) {
+        if(replay && (*itr)->_replay) connection->pendingRequests.enqueue(*itr);
+        else {
+            (*itr)->error("Connection Lost");
+            failedRequests.append(*itr);
+        }
     }
 
-    // socket successfull connected
+    // reconnect with exponential backoff (the first attempt is done instantly)
+    if(this->boolReconnect) {
+        int delay = !connection->intReconnectAttempts ? 0 : qMin(this->intReconnectMaxBackoff, 100 << qMin(connection->intReconnectAttempts - 1, 16));
+        QTimer::singleShot(delay, this, [this, socket]() { this->reconnectSocket(socket); });
+    }
+    for(auto itr = failedRequests.begin(); itr != failedRequests.end(); itr++) this->finishRequest(*itr, false);
+}
+
+void RedisServer::reconnectSocket(QIODevice* socket)
+{
+    // exit if the socket is connected allready
+    if(!RedisServer::isUnconnected(socket)) return;
+    Connection* connection = this->connection(socket);
+    connection->intReconnectAttempts++;
+    this->connectToServer(socket, socket == this->socketWriteOnly ? QIODevice::WriteOnly : QIODevice::ReadWrite);
+    if(socket == this->socketWriteOnly) return;
+
+    // negotiate the protocol first, reload the scripts (the server may have lost it's script cache), and replay the requests of the lost connection
+    this->handshake(socket);
+    QQueue<RedisServer::RedisRequest> requests = connection->pendingRequests;
+    connection->pendingRequests.clear();
+    this->reloadScripts(socket);
+    for(auto itr = requests.begin(); itr != requests.end(); itr++) {
+        (*itr)->response(RedisResponse(new RedisResponseData(socket)));
+        this->encodeCommand(connection->encoder, *(*itr)->_replay);
+        connection->pendingRequests.enqueue(*itr);
+    }
+    if(connection->encoder.flush(socket) == -1) this->failPendingRequests(connection);
+}
+
+void RedisServer::reconnect(bool enabled, int maxBackoff, bool replay)
+{
+    this->boolReconnect = enabled;
+    this->intReconnectMaxBackoff = maxBackoff;
+    this->boolReplay = replay;
+}
+
+bool RedisServer::isReadOnly(const QByteArray& name)
+{
+    // read only commands (they can be executed again without side effects, and can be served by replicas)
+    // Note: command names of this class are upper case allready, so they are found without conversion
+    static const QSet<QByteArray> commands { "PING", "GET", "MGET", "STRLEN", "EXISTS", "TYPE", "TTL", "PTTL", "KEYS", "SCAN",
+                                            "LLEN", "LRANGE", "LINDEX", "SCARD", "SMEMBERS", "SISMEMBER", "SSCAN", "ZCARD", "ZSCORE", "ZRANGE", "ZSCAN",
+                                            "HLEN", "HGET", "HMGET", "HGETALL", "HKEYS", "HVALS", "HEXISTS", "HSTRLEN", "HSCAN" };
+    return commands.contains(name) || commands.contains(name.toUpper());
+}
+
+QIODevice* RedisServer::balanceConnection(const QByteArray& routingKey)
+{
+    // exit if the pool is empty
+    if(this->lstReadWriteSockets.isEmpty()) return 0;
+
+    // pin requests by the hash of their key, so that all requests of a key are handled in order
+    if(this->enumBalancing == Balancing::KeyHash && !routingKey.isEmpty()) return this->lstReadWriteSockets.at(qHash(routingKey) % this->lstReadWriteSockets.size());
+
+    // otherwise use the connection with the least requests in flight
+    QIODevice* socket = 0;
+    int leastInFlight = 0;
+    // Note: lost connections are only used, if all connections are lost
+    for(auto itr = this->lstReadWriteSockets.begin(); itr != this->lstReadWriteSockets.end(); itr++) {
+        Connection* connection = this->connection(*itr);
+        int inFlight = connection->pendingRequests.size() + connection->pendingPipelineRequests.size();
+        if(RedisServer::isUnconnected(*itr)) {
+            if(!socket) socket = *itr;
+            continue;
+        }
+        if(!socket || RedisServer::isUnconnected(socket) || inFlight < leastInFlight) {
+            socket = *itr;
+            leastInFlight = inFlight;
+        }
+        if(!leastInFlight) break;
+    }
     return socket;
 }
 
-void RedisServer::freeBlockedConnection(QTcpSocket *socket)
+int RedisServer::pendingRequestCount()
+{
+    // count the requests in flight of all read/write connections (including the ones of the nodes of a cluster and of the replicas)
+    int count = 0;
+    for(auto itr = this->lstReadWriteSockets.begin(); itr != this->lstReadWriteSockets.end(); itr++) count += this->connection(*itr)->pendingRequests.size();
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) count += (*itr)->pendingRequestCount();
+    return count;
+}
+
+void RedisServer::readWriteConnections(int count)
+{
+    // the pool only grows, allready connected sockets stay in the pool
+    this->intReadWriteConnections = qMax(count, 1);
+}
+
+void RedisServer::handshake(QIODevice* socket)
+{
+    // nothing to negotiate for RESP2
+    Connection* connection = this->connection(socket);
+    connection->boolResp3 = false;
+    if(this->enumProtocol == Protocol::RESP2) return;
+
+    // Build and execute Command
+    // HELLO protover
+    // src: http://redis.io/commands/hello
+    // Note: the reply is parsed before the first reply of the connection (see parseHandshake)
+    this->encodeCommand(connection->encoder, RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHELLO\r\n"), "HELLO", { "3" }));
+    connection->encoder.flush(socket);
+    connection->handshakeResponse = RedisResponse(new RedisResponseData(socket));
+}
+
+bool RedisServer::parseHandshake(QIODevice* socket, bool waitForData)
+{
+    // exit if no handshake reply is pending
+    Connection* connection = this->connection(socket);
+    if(connection->handshakeResponse.isNull()) return true;
+
+    // parse the reply (and wait for it, if wanted)
+    RedisResponseParser::Result result;
+    while((result = connection->parser->parse(connection->handshakeResponse)) == RedisResponseParser::Result::Incomplete) {
+        if(!socket->bytesAvailable() && (!waitForData || !socket->waitForReadyRead())) return false;
+        connection->parser->readFrom(socket);
+    }
+
+    // without RESP3 support the connection continues using RESP2
+    connection->boolResp3 = result == RedisResponseParser::Result::Complete && !connection->handshakeResponse->hasError();
+    if(!connection->boolResp3) qWarning("Cannot switch to RESP3 on Redis Server %s:%i, continue using RESP2...", qPrintable(this->strRedisConnectionHost), this->intRedisConnectionPort);
+    connection->handshakeResponse.clear();
+    return true;
+}
+
+bool RedisServer::enableClientCache(qint64 maxMemory)
+{
+    // every node of a cluster caches the fields of it's own slots
+    if(this->boolCluster) {
+        if(this->vecShardRing.empty() && this->vecClusterSlots.empty() && !this->discoverSlots()) return false;
+        bool success = true;
+        QList<RedisServer*> nodes = this->clusterMasters();
+        for(auto itr = nodes.begin(); itr != nodes.end(); itr++) success = (*itr)->enableClientCache(maxMemory) && success;
+        return success;
+    }
+
+    // if the cache is allready enabled, just apply the new memory cap
+    if(this->clientCacheInstance) {
+        this->clientCacheInstance->maxMemory(maxMemory);
+        return true;
+    }
+
+    // connect the invalidation connection, all tracked connections redirect their invalidation messages to it
+    QIODevice* socket = this->createSocket();
+    this->connectToServer(socket, QIODevice::ReadWrite);
+    if(!RedisServer::waitForConnected(socket, 5000)) {
+        qWarning("Cannot connect to Redis Server %s:%i, client cache disabled...", qPrintable(this->strRedisConnectionHost), this->intRedisConnectionPort);
+        delete socket;
+        return false;
+    }
+    this->handshake(socket);
+
+    // Build and execute Command
+    // CLIENT ID
+    // src: http://redis.io/commands/client-id
+    RedisServer::RedisRequest request = this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$6\r\nCLIENT\r\n$2\r\nID\r\n"), "CLIENT", {}), RequestType::WriteOnlyBlocked, socket);
+    bool success = !request->hasError() && this->parseResponse(request) && !request->response()->hasError();
+    qint64 clientId = request->response()->reply().integer();
+    bool resp3 = this->connection(socket)->boolResp3;
+
+    // RESP3 connections receive invalidations as push frames, RESP2 connections have to subscribe to the invalidation channel
+    // Build and execute Command
+    // SUBSCRIBE __redis__:invalidate
+    // src: http://redis.io/commands/subscribe
+    if(success && !resp3) {
+        request = this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$9\r\nSUBSCRIBE\r\n"), "SUBSCRIBE", { "__redis__:invalidate" }), RequestType::WriteOnlyBlocked, socket);
+        success = !request->hasError() && this->parseResponse(request) && !request->response()->hasError();
+    }
+
+    // cleanup on fail (e.g. redis doesn't support client side caching)
+    if(!success) {
+        qWarning("Redis Server %s:%i doesn't support client side caching, client cache disabled...", qPrintable(this->strRedisConnectionHost), this->intRedisConnectionPort);
+        delete this->hashConnections.take(socket);
+        delete socket;
+        return false;
+    }
+
+    // create cache and handle invalidations
+    this->socketInvalidation = socket;
+    this->intInvalidationClientId = clientId;
+    this->clientCacheInstance = new RedisClientCache(maxMemory);
+    QObject::connect(this->socketInvalidation, &QIODevice::readyRead, this, &RedisServer::handleInvalidation);
+    RedisServer::connectStateChanged(this->socketInvalidation, this, &RedisServer::handleInvalidationState);
+    return true;
+}
+
+void RedisServer::handleInvalidationState()
+{
+    // the client cache is dropped with it's invalidation connection
+    if(this->socketInvalidation && RedisServer::isUnconnected(this->socketInvalidation)) this->disableClientCache();
+}
+
+void RedisServer::disableClientCache()
 {
-    // append socket to blocked connection list
-    if(socket) this->lstBlockedSockets.enqueue(socket);
+    // without invalidation connection the cache can't be kept coherent, so it's dropped
+    // Note: the socket may be the sender of the current signal, so it's deleted later
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) (*itr)->disableClientCache();
+    if(!this->socketInvalidation) return;
+    this->socketInvalidation->disconnect(this);
+    this->socketInvalidation->deleteLater();
+    delete this->hashConnections.take(this->socketInvalidation);
+    this->socketInvalidation = 0;
+    this->intInvalidationClientId = 0;
+    this->invalidationResponse.clear();
+    delete this->clientCacheInstance;
+    this->clientCacheInstance = 0;
 }
 
-RedisServer::RedisRequest RedisServer::execRedisCommand(std::list<QByteArray> cmd, RequestType type, QTcpSocket* socket)
+bool RedisServer::enableTracking(QIODevice* socket)
 {
+    // exit if the connection is allready tracked by the current invalidation connection
+    Connection* connection = this->connection(socket);
+    if(connection->intTrackingRedirect == this->intInvalidationClientId) return true;
+
+    // Build and execute Command
+    // CLIENT TRACKING on REDIRECT client-id
+    // src: http://redis.io/commands/client-tracking
+    RedisServer::RedisRequest request = this->execRedisCommand(RedisCommand(QByteArrayLiteral("*5\r\n$6\r\nCLIENT\r\n$8\r\nTRACKING\r\n"), "CLIENT", { "on", "REDIRECT", QByteArray::number(this->intInvalidationClientId) }), RequestType::WriteOnlyBlocked, socket);
+    if(request->hasError() || !this->parseResponse(request) || request->response()->hasError()) return false;
+    connection->intTrackingRedirect = this->intInvalidationClientId;
+    return true;
+}
+
+QByteArray RedisServer::cachedHget(QByteArray list, QByteArray key)
+{
+    // the field is cached by the node of the list
+    if(this->boolCluster) {
+        RedisServer* node = this->clusterNode(list);
+        return node ? node->cachedHget(list, key) : QByteArray();
+    }
+
+    // without client cache, this is a simple HGET
+    if(!this->clientCacheInstance) return this->hget(list, key, RequestType::Syncron)->response()->string();
+
+    // serve hot reads from the client cache (invalidations, which are received but not handled yet, are handled first)
+    // Note: syncron callers may never return to the event loop, so the invalidation connection can't rely on readyRead only
+    QByteArray value;
+    this->drainInvalidations();
+    if(this->clientCacheInstance && this->clientCacheInstance->lookup(list, key, value)) return value;
+    if(!this->clientCacheInstance) return this->hget(list, key, RequestType::Syncron)->response()->string();
+
+    // otherwise read the field on a tracked connection, so that redis informs us about changes of it
+    QIODevice* socket = this->requestConnection(RedisServer::ConnectionType::Blocked);
+    if(!socket) return QByteArray();
+    if(!this->enableTracking(socket)) {
+        this->freeBlockedConnection(socket);
+        return this->hget(list, key, RequestType::Syncron)->response()->string();
+    }
+
+    // Build and execute Command
+    // HGET list key
+    // src: http://redis.io/commands/hget
+    quint64 epoch = this->clientCacheInstance->epoch();
+    RedisServer::RedisRequest request = this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$4\r\nHGET\r\n"), "HGET", { list, key }), RequestType::Syncron, socket);
+    if(request->hasError() || request->response()->hasError()) return QByteArray();
+
+    // cache the field (the cache may be dropped in the meantime, if the invalidation connection was lost)
+    // Note: an invalidation received during the read starts a new epoch, so the field isn't cached then
+    value = request->response()->string();
+    this->drainInvalidations();
+    if(this->clientCacheInstance) this->clientCacheInstance->insert(list, key, value, epoch);
+    return value;
+}
+
+void RedisServer::freeBlockedConnection(QIODevice *socket)
+{
+    // append socket to blocked connection list (of the node, the socket belongs to)
+    if(!socket) return;
+    if(!this->boolCluster) this->lstBlockedSockets.enqueue(socket);
+    else if(RedisServer* node = this->clusterNodeOf(socket)) node->freeBlockedConnection(socket);
+}
+
+RedisServer::RedisRequest RedisServer::execRedisCommand(const std::list<QByteArray>& cmd, RequestType type, QIODevice* socket)
+{
+    // split the command into name and arguments
+    if(cmd.empty()) return RedisServer::RedisRequest(new RedisRequestData(type, "Empty Command"));
+    return this->execRedisCommand(RedisCommand(cmd.front(), std::vector<QByteArray>(++cmd.begin(), cmd.end())), type, socket);
+}
+
+RedisServer::RedisRequest RedisServer::execRedisCommand(const RedisCommand& cmd, RequestType type, QIODevice* socket)
+{
+    // pipeline requests of RedisPipeline::exec (or RedisTransaction::exec) are added to it's pipeline (or transaction)
+    if(type == RequestType::PipeLine && this->transactionTarget) return this->transactionTarget->exec(cmd);
+    if(type == RequestType::PipeLine && this->pipelineTarget) return this->pipelineTarget->exec(cmd);
+
+    // build and execute request
+    RedisServer::RedisRequest request(new RedisRequestData(type, socket));
+    this->executeRequest(request, cmd, socket);
+    return request;
+}
+
+QList<RedisServer::RedisRequest> RedisServer::execRedisCommands(const std::vector<RedisCommand>& cmds, QIODevice* socket)
+{
+    // a cluster splits the batch into one batch per node (the requests keep the order of the commands)
+    if(this->boolCluster) {
+        RedisServer* node = socket ? this->clusterNodeOf(socket) : 0;
+        if(node) return node->execRedisCommands(cmds, socket);
+        QList<RedisServer::RedisRequest> requests;
+        RedisPipeline pipeline(*this, RedisServer::ConnectionType::Blocked, QByteArray(), cmds.size() + 1, std::numeric_limits<qint64>::max());
+        for(auto itr = cmds.begin(); itr != cmds.end(); itr++) requests.append(pipeline.exec(*itr));
+        pipeline.flush(RequestType::Syncron);
+        return requests;
+    }
+
+    // acquire blocked socket, if not available
+    QIODevice* blockedSocket = socket ? socket : this->requestConnection(RedisServer::ConnectionType::Blocked);
+
+    // encode all RESP requests into the output buffer of the connection
+    QList<RedisServer::RedisRequest> requests;
+    requests.reserve(cmds.size());
+    for(auto itr = cmds.begin(); itr != cmds.end(); itr++) {
+        RedisServer::RedisRequest request(blockedSocket ? new RedisRequestData(RequestType::Syncron, blockedSocket) : new RedisRequestData(RequestType::Syncron, "No Socket"));
+        request->cmd(itr->name);
+        if(blockedSocket) this->encodeCommand(this->connection(blockedSocket)->encoder, *itr);
+        requests.append(request);
+    }
+    if(!blockedSocket) return requests;
+
+    // write and parse the batch (and free an acquired socket)
+    this->executeBatch(requests, this->connection(blockedSocket)->encoder, blockedSocket);
+    if(!socket) this->freeBlockedConnection(blockedSocket);
+    return requests;
+}
+
+void RedisServer::executeBatch(QList<RedisServer::RedisRequest>& requests, RedisCommandEncoder& encoder, QIODevice* socket)
+{
+    // check socket
+    for(auto itr = requests.begin(); itr != requests.end(); itr++) (*itr)->socket(socket);
+    QString error = !socket ? "No Socket" : encoder.flush(socket) == -1 ? "Write Error" : "";
+    encoder.clear();
+
+    // parse the replies in order (replies, which are received together, are parsed without waiting)
+    // Note: after a failed reply the order of the connection is lost, so the remaining requests fail instantly
+    for(auto itr = requests.begin(); itr != requests.end(); itr++) {
+        if(error.isEmpty() && !this->parseResponse(*itr)) error = "Redis Parse Error";
+        if(!error.isEmpty()) (*itr)->error(error);
+        (*itr)->finish(error.isEmpty());
+    }
+}
+
+void RedisServer::executeRequest(RedisServer::RedisRequest& request, const RedisCommand& cmd, QIODevice* socket)
+{
+    // requests of a cluster are executed by the node of their key
+    if(this->boolCluster) {
+        this->executeClusterRequest(request, cmd, socket);
+        return;
+    }
+
+    // read only requests are served by a replica, if the read policy allows it (writes are tracked for read your writes)
+    RequestType type = request->type();
+    if(!socket && !this->lstReplicas.isEmpty() && type != RequestType::WriteOnly && type != RequestType::WriteOnlyBlocked) {
+        RedisServer* replica = this->readReplica(cmd);
+        if(replica) {
+            replica->executeRequest(request, cmd, 0);
+            return;
+        }
+    }
+    if(this->enumReadPolicy == ReadPolicy::ReadYourWrites && !this->lstReplicas.isEmpty()) this->trackWrite(cmd);
+
     // if socket is not available, try to acquire socket by RequestType
     if(!socket) {
         ConnectionType conType = type == RequestType::WriteOnly      ?  RedisServer::ConnectionType::WriteOnly :
                                  type == RequestType::Syncron        ?  RedisServer::ConnectionType::Blocked :
                                                                         RedisServer::ConnectionType::ReadWrite;
-        socket = this->requestConnection(conType);
+        socket = this->requestConnection(conType, cmd.key());
+        request->socket(socket);
     }
 
-    // check socket
-    RedisServer::RedisRequest request(new RedisRequestData(type, socket));
-    request->cmd(cmd.front());
-    if(!socket) {
-        request->error("No Socket");
-        return request;
+    // check socket (requests fail fast, while the connection is lost)
+    request->cmd(cmd.name);
+    if(!socket || RedisServer::isUnconnected(socket)) {
+        request->error(!socket ? "No Socket" : "Not Connected");
+        if(socket && type == RequestType::Syncron) this->freeBlockedConnection(socket);
+        request->finish(false);
+        return;
     }
 
-    /// Build and execute RESP request
-    /// see: http://redis.io/topics/protocol#resp-arrays
-    // 1. determine RESP request packet size
-    int size = 15;
-    for(auto itr = cmd.begin(); itr != cmd.end(); itr++) size += 15 + itr->length();
-
-    // 2. build RESP request
-    char contentOriginPos[size];
-    char* content = contentOriginPos;
-
-    // build packet
-    *content++ = '*';
-    itoa(cmd.size(), content, 10);
-    content += this->numIntPlaces(cmd.size());
-    content = (char*)mempcpy(content, "\r\n", 2);
-    for(auto itr = cmd.begin(); itr != cmd.end(); itr++) {
-        *content++ = '$';
-        itoa(itr->isNull() ? -1 : itr->length(), content, 10);
-        content += (int)itr->isNull() ? 2 : itr->isEmpty() ? 1 : this->numIntPlaces(itr->length());
-        content = (char*)mempcpy(content, "\r\n", 2);
-        if(!itr->isNull()) {
-            content = (char*)mempcpy(content, itr->data(), itr->length());
-            content = (char*)mempcpy(content, "\r\n", 2);
+    // 1. encode RESP request directly into the output buffer of the connection (or into it's pipeline buffer)
+    Connection* connection = this->connection(socket);
+    RedisCommandEncoder& encoder = type == RequestType::PipeLine ? connection->pipeline : connection->encoder;
+    this->encodeCommand(encoder, cmd);
+
+    // 2. write RESP request to socket (and exit on error)
+    // Note: if flushes are deferred (or auto pipelined), asyncron requests are written later together with all other requests of the connection
+    bool deferred = type == RequestType::Asyncron && (this->boolDeferFlush || this->boolAutoPipelining);
+    if(type == RequestType::PipeLine);
+    else if(deferred) {
+        if(!connection->boolFlushPending) this->lstFlushConnections.append(socket);
+        connection->boolFlushPending = true;
+        connection->intUnflushedCommands++;
+
+        // auto pipelined requests are written, when control returns to the event loop
+        if(!this->boolDeferFlush && !this->boolFlushScheduled) {
+            this->boolFlushScheduled = true;
+            QMetaObject::invokeMethod(this, "flushConnections", Qt::QueuedConnection);
         }
-    }
-
-    // 3. write RESP request to socket (and exit on error)
-    if(type != RequestType::PipeLine && socket->write(QByteArray::fromRawData(contentOriginPos, content - contentOriginPos)) == -1) {
+    } else if(encoder.flush(socket) == -1) {
         request->error("Write Error");
-        return request;
+        request->finish(false);
+        return;
     }
 
-    // 4. handle types
-    if(type == RequestType::WriteOnly);
-    else if(socket != this->socketReadWrite && (type == RequestType::Asyncron || type == RequestType::PipeLine)) {
-        qWarning("Executions of %s-Requests are only supported on RedisServer's own ReadWrite Socket, request may not handled correctly...", type == RequestType::Asyncron ? "Asyncron" : "Pipeline");
+    // 3. handle types (asyncron and pipeline requests are finished, when their reply is handled)
+    if(type == RequestType::WriteOnly) request->finish(true);
+    else if(!this->lstReadWriteSockets.contains(socket) && (type == RequestType::Asyncron || type == RequestType::PipeLine)) {
+        qWarning("Executions of %s-Requests are only supported on RedisServer's own ReadWrite Sockets, request may not handled correctly...", type == RequestType::Asyncron ? "Asyncron" : "Pipeline");
+        request->finish(false);
     } else if(type == RequestType::Syncron) {
-        if(!this->parseResponse(request)) request->error("Redis Parse Error");
+        bool success = this->parseResponse(request);
+        if(!success) request->error("Redis Parse Error");
         this->freeBlockedConnection(socket);
-    } else if(type == RequestType::WriteOnlyBlocked && !socket->waitForBytesWritten()) {
-        request->error("Write Wait Error");
+        request->finish(success);
+    } else if(type == RequestType::WriteOnlyBlocked) {
+        bool success = socket->waitForBytesWritten();
+        if(!success) request->error("Write Wait Error");
+        request->finish(success);
     } else if(type == RequestType::Asyncron) {
-        this->pendingRequests.enqueue(request);
+        connection->pendingRequests.enqueue(request);
+        if(this->boolReconnect && this->boolReplay && RedisServer::isReadOnly(cmd.name)) request->_replay.reset(new RedisCommand(cmd));
     } else if(type == RequestType::PipeLine) {
-        this->pendingPipelineRequests.enqueue(request);
-        this->pendingPipelineData.append(QByteArray::fromRawData(contentOriginPos, content - contentOriginPos));
+        connection->pendingPipelineRequests.enqueue(request);
+    }
+
+    // 4. write deferred requests instantly, if the connection exceeds the auto pipelining thresholds
+    if(deferred && (connection->encoder.size() >= this->intAutoPipeliningMaxBytes || connection->intUnflushedCommands >= this->intAutoPipeliningMaxCommands)) {
+        this->flushConnection(socket, connection);
     }
 
-    // return response
+    // 5. inform producers, if the read/write connections are congested
+    if(type == RequestType::Asyncron || type == RequestType::PipeLine) this->checkBackpressure();
+}
+
+void RedisServer::backpressure(int highInFlight, int lowInFlight, qint64 highUnsentBytes, qint64 lowUnsentBytes)
+{
+    this->intHighInFlight = highInFlight;
+    this->intLowInFlight = qMin(lowInFlight, highInFlight);
+    this->intHighUnsentBytes = highUnsentBytes;
+    this->intLowUnsentBytes = qMin(lowUnsentBytes, highUnsentBytes);
+    this->checkBackpressure();
+}
+
+RedisServer::RedisRequest RedisServer::writable()
+{
+    // the request is finished, when the producers are resumed
+    RedisServer::RedisRequest request(new RedisRequestData(RequestType::Asyncron, (QIODevice*)0));
+    if(!this->boolPaused) request->finish(true);
+    else this->lstWritableRequests.append(request);
     return request;
 }
 
-bool RedisServer::parseResponse(RedisServer::RedisRequest& request)
+RedisServer::QueueStats RedisServer::queueStats()
+{
+    QueueStats stats = this->queueStatsData;
+    stats.inFlight = this->pendingRequestCount();
+    stats.unsentBytes = this->unsentBytes();
+    return stats;
+}
+
+void RedisServer::resetQueueStats()
+{
+    this->queueStatsData = QueueStats();
+}
+
+qint64 RedisServer::unsentBytes()
+{
+    // encoded requests and the write buffers of all read/write connections
+    qint64 bytes = 0;
+    for(auto itr = this->lstReadWriteSockets.begin(); itr != this->lstReadWriteSockets.end(); itr++) {
+        Connection* connection = this->connection(*itr);
+        bytes += (*itr)->bytesToWrite() + connection->encoder.size() + connection->pipeline.size();
+    }
+    return bytes;
+}
+
+void RedisServer::checkBackpressure()
+{
+    // exit if no watermark is set (paused producers are resumed in that case)
+    bool enabled = this->intHighInFlight || this->intHighUnsentBytes;
+    if(!enabled && !this->boolPaused) return;
+
+    // update stats
+    int inFlight = this->pendingRequestCount();
+    qint64 unsent = this->unsentBytes();
+    this->queueStatsData.maxInFlight = qMax(this->queueStatsData.maxInFlight, inFlight);
+    this->queueStatsData.maxUnsentBytes = qMax(this->queueStatsData.maxUnsentBytes, unsent);
+
+    // pause producers, if any high watermark is reached
+    if(!this->boolPaused) {
+        if((!this->intHighInFlight || inFlight < this->intHighInFlight) && (!this->intHighUnsentBytes || unsent < this->intHighUnsentBytes)) return;
+        this->boolPaused = true;
+        this->queueStatsData.pauses++;
+        emit this->redisBackpressure(true);
+    }
+
+    // resume producers, if all low watermarks are reached
+    else if(!enabled || ((!this->intHighInFlight || inFlight <= this->intLowInFlight) && (!this->intHighUnsentBytes || unsent <= this->intLowUnsentBytes))) {
+        this->boolPaused = false;
+        emit this->redisBackpressure(false);
+        QList<RedisServer::RedisRequest> requests = this->lstWritableRequests;
+        this->lstWritableRequests.clear();
+        for(auto itr = requests.begin(); itr != requests.end(); itr++) (*itr)->finish(true);
+    }
+}
+
+void RedisServer::autoPipelining(bool enabled, qint64 maxBytes, int maxCommands)
+{
+    // write allready deferred requests, before the thresholds change
+    if(!enabled) this->flushConnections();
+    this->boolAutoPipelining = enabled;
+    this->intAutoPipeliningMaxBytes = maxBytes;
+    this->intAutoPipeliningMaxCommands = maxCommands;
+}
+
+void RedisServer::flushConnections()
+{
+    // write all deferred requests at once per connection
+    this->boolFlushScheduled = false;
+    for(auto itr = this->lstFlushConnections.begin(); itr != this->lstFlushConnections.end(); itr++) {
+        Connection* connection = this->connection(*itr);
+        if(connection->boolFlushPending) this->flushConnection(*itr, connection);
+    }
+    this->lstFlushConnections.clear();
+}
+
+void RedisServer::flushConnection(QIODevice* socket, Connection* connection)
+{
+    // write all deferred requests of the connection
+    connection->boolFlushPending = false;
+    connection->intUnflushedCommands = 0;
+    if(connection->encoder.flush(socket) != -1) return;
+    this->failPendingRequests(connection);
+}
+
+void RedisServer::failPendingRequests(Connection* connection)
+{
+    // the requests of a failed connection will never be answered
+    while(!connection->pendingRequests.isEmpty()) {
+        RedisServer::RedisRequest request = connection->pendingRequests.dequeue();
+        request->error("Write Error");
+        this->finishRequest(request, false);
+    }
+}
+
+void RedisServer::finishRequest(RedisServer::RedisRequest& request, bool success)
+{
+    // finish the request and inform outside world (redirected cluster requests are finished by their new node)
+    if(request->finish(success)) emit this->redisResponseFinished(request, success);
+}
+
+void RedisServer::RedisRequestData::then(Callback callback, QObject* context)
+{
+    // register callback, until the request is finished
+    ContextCallback contextCallback { callback, context, context != 0 };
+    QMutexLocker locker(&this->_mutex);
+    if(!this->isFinished()) {
+        this->_callbacks.push_back(contextCallback);
+        return;
+    }
+    locker.unlock();
+
+    // otherwise call it instantly
+    if(!contextCallback.hasContext) callback(this->sharedFromThis());
+    else if(!contextCallback.context.isNull()) {
+        RedisServer::RedisRequest request = this->sharedFromThis();
+        QMetaObject::invokeMethod(context, [callback, request]() { callback(request); }, Qt::QueuedConnection);
+    }
+}
+
+bool RedisServer::RedisRequestData::finish(bool success)
+{
+    // redirected cluster requests are finished by their new node
+    if(this->_redirect && !this->isFinished() && this->_redirect(this->sharedFromThis())) return false;
+
+    // a request is finished only once
+    QMutexLocker locker(&this->_mutex);
+    if(this->isFinished()) return false;
+    this->_success = success;
+    this->_finished.store(true, std::memory_order_release);
+    std::vector<ContextCallback> callbacks;
+    callbacks.swap(this->_callbacks);
+    locker.unlock();
+
+    // wake up waiting threads (or the waiting event loop of this thread)
+    this->_semaphore.release();
+    if(this->_eventLoop) this->_eventLoop->quit();
+
+    // call all callbacks (in the thread of their context, if they have one)
+    if(callbacks.empty()) return true;
+    RedisServer::RedisRequest request = this->sharedFromThis();
+    for(auto itr = callbacks.begin(); itr != callbacks.end(); itr++) {
+        if(!itr->hasContext) itr->callback(request);
+        else if(!itr->context.isNull()) {
+            Callback callback = itr->callback;
+            QMetaObject::invokeMethod(itr->context.data(), [callback, request]() { callback(request); }, Qt::QueuedConnection);
+        }
+    }
+    return true;
+}
+
+bool RedisServer::RedisRequestData::waitForFinished(int msecs)
+{
+    // exit if the request is allready finished
+    if(this->isFinished()) return true;
+
+    // if the reply is handled by this thread, we have to run it's event loop until the request is finished
+    if(QThread::currentThread() == this->_thread) {
+        QEventLoop loop;
+        this->_eventLoop = &loop;
+        if(msecs >= 0) QTimer::singleShot(msecs, &loop, &QEventLoop::quit);
+        if(!this->isFinished()) loop.exec();
+        this->_eventLoop = 0;
+        return this->isFinished();
+    }
+
+    // otherwise wait until the thread, which handles the reply, finishes the request
+    if(!this->_semaphore.tryAcquire(1, msecs)) return false;
+    this->_semaphore.release();
+    return true;
+}
+
+RedisServer::RedisRequest RedisServer::whenAll(const QList<RedisRequest>& requests)
+{
+    // the combined request finishes with the last request (and is only successfull, if all requests are successfull)
+    RedisServer::RedisRequest combined(new RedisRequestData(RequestType::Asyncron, (QIODevice*)0));
+    if(!requests.isEmpty()) combined->_thread = requests.first()->_thread;
+    std::shared_ptr<std::atomic<int>> remaining = std::make_shared<std::atomic<int>>(requests.size() + 1);
+    std::shared_ptr<std::atomic<bool>> success = std::make_shared<std::atomic<bool>>(true);
+    auto finished = [combined, remaining, success](RedisServer::RedisRequest request) {
+        if(request && !request->isSuccess()) success->store(false);
+        if(--(*remaining) == 0) combined->finish(success->load());
+    };
+    for(auto itr = requests.begin(); itr != requests.end(); itr++) (*itr)->then(finished);
+
+    // the extra count prevents finishing before all callbacks are registered
+    finished(RedisServer::RedisRequest());
+    return combined;
+}
+
+RedisServer::RedisRequest RedisServer::whenAny(const QList<RedisRequest>& requests)
+{
+    // the combined request finishes with the first request, and stores it's index
+    RedisServer::RedisRequest combined(new RedisRequestData(RequestType::Asyncron, (QIODevice*)0));
+    if(!requests.isEmpty()) combined->_thread = requests.first()->_thread;
+    for(int i = 0; i < requests.size(); i++) {
+        requests.at(i)->then([combined, i](RedisServer::RedisRequest request) {
+            if(combined->isFinished()) return;
+            QMutexLocker locker(&combined->_mutex);
+            if(combined->hasCustomData()) return;
+            combined->customData(i);
+            locker.unlock();
+            combined->finish(request->isSuccess());
+        });
+    }
+    return combined;
+}
+
+bool RedisServer::startIoThread()
+{
+    // exit if the io thread is allready running
+    if(this->threadIo) return true;
+
+    // move this server and all of it's sockets into the io thread
+    // Note: this has to be done by the thread, this server belongs to
+    if(this->thread() != QThread::currentThread()) {
+        qWarning("The io thread has to be started by the thread, the RedisServer belongs to...");
+        return false;
+    }
+    this->threadIo = new QThread;
+    this->moveSockets(this->threadIo);
+    this->moveToThread(this->threadIo);
+    this->threadIo->start();
+    return true;
+}
+
+void RedisServer::stopIoThread()
+{
+    // exit if the io thread is not running
+    if(!this->threadIo) return;
+
+    // called by the io thread itself, this server is moved back into the thread, which started the io thread
+    // Note: a blocking queued call into the current thread would dead lock, and a thread can't wait for itself
+    if(QThread::currentThread() == this->threadIo) {
+        QThread* thread = this->threadIo->thread();
+        this->moveSockets(thread);
+        this->moveToThread(thread);
+        this->quitIoThread();
+        return;
+    }
+
+    // move this server and all of it's sockets back into the calling thread (this has to be done by the io thread itself)
+    QThread* thread = QThread::currentThread();
+    QMetaObject::invokeMethod(this, [this, thread]() {
+        this->moveSockets(thread);
+        this->moveToThread(thread);
+    }, Qt::BlockingQueuedConnection);
+
+    // stop io thread
+    this->threadIo->quit();
+    this->threadIo->wait();
+    delete this->threadIo;
+    this->threadIo = 0;
+}
+
+void RedisServer::quitIoThread()
+{
+    // the io thread stops, when control returns to it's event loop (and is deleted by the thread, which started it, afterwards)
+    QThread* thread = this->threadIo;
+    this->threadIo = 0;
+    QObject::connect(thread, &QThread::finished, thread, &QObject::deleteLater);
+    thread->quit();
+}
+
+void RedisServer::moveSockets(QThread* thread)
+{
+    // Note: blocked sockets, which are in use (e.g. by a RedisListPoller) are not moved
+    if(this->socketWriteOnly) this->socketWriteOnly->moveToThread(thread);
+    if(this->socketInvalidation) this->socketInvalidation->moveToThread(thread);
+    for(auto itr = this->lstReadWriteSockets.begin(); itr != this->lstReadWriteSockets.end(); itr++) (*itr)->moveToThread(thread);
+    for(auto itr = this->lstBlockedSockets.begin(); itr != this->lstBlockedSockets.end(); itr++) (*itr)->moveToThread(thread);
+
+    // the nodes of a cluster and the replicas are children of this server, so only their sockets have to be moved
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) (*itr)->moveSockets(thread);
+}
+
+RedisServer::RedisRequest RedisServer::submit(const RedisCommand& cmd, std::function<void(RedisRequest)> callback, QObject* context)
+{
+    // build request (the socket is assigned by the io thread)
+    RedisServer::RedisRequest request(new RedisRequestData(RequestType::Asyncron, (QIODevice*)0));
+    request->cmd(cmd.name);
+    request->_thread = this->thread();
+    if(callback) request->then(callback, context);
+
+    // enqueue it lock-free and schedule a drain of the queue, if no drain is scheduled yet
+    // Note: only the first submission after a drain posts an event into the io thread
+    Submission submission;
+    submission.request = request;
+    submission.cmd = cmd;
+    this->queueSubmissions.push(submission);
+    if(!this->boolDrainScheduled.exchange(true)) QMetaObject::invokeMethod(this, "drainSubmissions", Qt::QueuedConnection);
+    return request;
+}
+
+void RedisServer::drainSubmissions()
+{
+    // allow to schedule the next drain before draining, so that no submission gets lost
+    this->boolDrainScheduled.store(false);
+
+    // execute all submitted requests, but write them at once per connection (of every node of a cluster and every replica)
+    this->boolDeferFlush = true;
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) (*itr)->boolDeferFlush = true;
+    Submission submission;
+    while(this->queueSubmissions.pop(submission)) this->executeRequest(submission.request, submission.cmd, 0);
+    this->boolDeferFlush = false;
+    this->flushConnections();
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) {
+        (*itr)->boolDeferFlush = false;
+        (*itr)->flushConnections();
+    }
+}
+
+void RedisServer::encodeCommand(RedisCommandEncoder& encoder, const RedisCommand& cmd)
+{
+    /// Build RESP request
+    /// see: http://redis.io/topics/protocol#resp-arrays
+    // use the pre encoded header if available (otherwise encode argument count and command name)
+    if(cmd.header.startsWith('*')) encoder.appendRaw(cmd.header);
+    else {
+        encoder.beginArray(1 + cmd.args.size());
+        if(cmd.header.isEmpty()) encoder.appendBulk(cmd.name);
+        else encoder.appendRaw(cmd.header);
+    }
+
+    // encode arguments
+    for(auto itr = cmd.args.begin(); itr != cmd.args.end(); itr++) encoder.appendBulk(*itr);
+}
+
+bool RedisServer::parseResponse(RedisServer::RedisRequest& request, bool waitForData)
 {
     // pointer check
     if(request.isNull()) return false;
 
-    // build response
-    QTcpSocket* socket = request->socket();
+    // replies of a cluster are parsed by the node of the socket
+    // Note: MOVED redirects update the slot map, even if the reply is parsed by the caller (e.g. by a RedisListPoller)
+    if(this->boolCluster) {
+        RedisServer* node = this->clusterNodeOf(request->socket());
+        if(!node) {
+            request->response()->error("Not Socket");
+            return false;
+        }
+        bool asking;
+        bool success = node->parseResponse(request, waitForData);
+        if(success && request->response()->hasError()) this->redirectNode(request->response(), asking);
+        return success;
+    }
+
+    // parse the reply into the response of the request
     RedisResponse response = request->response();
+    return this->parseReply(request->socket(), response, waitForData);
+}
 
+bool RedisServer::parseReply(QIODevice* socket, RedisServer::RedisResponse& response, bool waitForData)
+{
     // some error checks
     if(!socket) {
         response->error("Not Socket");
@@ -163,175 +1050,170 @@ bool RedisServer::parseResponse(RedisServer::RedisRequest& request)
         return false;
     }
 
-    // get data (wait syncronly if no data is available)
-    if(!socket->bytesAvailable()) socket->waitForReadyRead();
-    QByteArray data = socket->read(10);
-
-    /// Parse RESP Response
-    /// see: http://redis.io/topics/protocol#resp-protocol-description
-
-    // readSegement
-    // - be sure enough data is available to read the next protocol segment
-    //   if not enough data is given remove allready parsed data and realloc the rawData to point to the new data
-    // returns: a pointer to the next char after the end of the segment
-    // Note: if no segmentLength is given (segmentLength = 0), the end of the next segment is determined by searching for the next '\n' and returns the position after that char
-    //       if segmentLength is given, the end of the segment is the next char after segmentLength chars
-    auto readSegement = [&socket, &data](char** rawData, int segmentLength = 0) {
-        // loop until we have enough data to parse the next segment
-        char* protoSegmentEnd = 0;
-        while((!segmentLength && !(protoSegmentEnd = strstr(*rawData, "\n"))) || (segmentLength && data.size() - (*rawData - data.data()) < segmentLength)) {
-            // remove allready parsed data from cache
-            data.remove(0, *rawData - data.data());
-
-            // if no data is present so we wait for it
-            if(!socket->bytesAvailable()) socket->waitForReadyRead();
-
-            // read all available data and update the raw pointer
-            data += socket->read(10);
-            *rawData = data.data();
-        }
-        return !segmentLength ? ++protoSegmentEnd : *rawData + segmentLength;
-    };
-
-    // simplify variables
-    char* rawData = data.data();
-    char respDataType = *rawData++;
-
-    // determine type
-    response->type(respDataType == '+' ? RedisResponseData::Type::String :
-                   respDataType == '-' ? RedisResponseData::Type::Error :
-                   respDataType == ':' ? RedisResponseData::Type::Integer :
-                   respDataType == '$' ? RedisResponseData::Type::String :
-                   respDataType == '*' ? RedisResponseData::Type::Array : RedisResponseData::Type::ArrayList);
-
-    // handle BulkString
-    if(respDataType == '$') {
-        // get string length and be sure we have enough data to read
-        char* protoSegmentNext = readSegement(&rawData);
-        int length = atoi(rawData);
-        rawData = protoSegmentNext;
-
-        // get whole string of previous parsed length and be sure we have enough data to read
-        QByteArray segmentData;
-        if(length != -1) {
-            protoSegmentNext = readSegement(&rawData, length + 2);
-            segmentData = QByteArray(rawData, length);
-            rawData = protoSegmentNext;
-        }
-
-        // construct RedisString
-        response->string(segmentData);
-    }
-
-    // handle base types (SimpleString, Error and Integer)
-    else if(response->type() == RedisResponseData::Type::String ||
-            response->type() == RedisResponseData::Type::Error ||
-            response->type() == RedisResponseData::Type::Integer)
-    {
-        // get pointer to end of current segment and be sure we have enough data available to read
-        char* protoSegmentNext = readSegement(&rawData);
-
-        // read segment (but without the segment end chars \r and \n)
-        QByteArray segment = QByteArray(rawData, protoSegmentNext - rawData - 2);
-        rawData = protoSegmentNext;
-
-        // set data to redis structs
-        if(response->type() == RedisResponseData::Type::String)  response->string(segment);
-        if(response->type() == RedisResponseData::Type::Error)   response->error(QString(segment));
-        if(response->type() == RedisResponseData::Type::Integer) response->integer(segment.toInt());
-    }
-    // handle Arrays and Multi Bulk Arrays
-    else if(response->type() == RedisResponseData::Type::Array) {
-        rawData--;
-
-        // parse array
-        std::list<QByteArray>* currentArray = 0;
-        int currentElementCount = 0;
-        int allElementsCount = 0;
-
-        // parse array elements
-        do {
-            // read segment
-            char* protoSegmentNext = readSegement(&rawData);
-
-            // parse packet header
-            char packetType = *rawData++;
-            int length = atoi(rawData);
-            rawData = protoSegmentNext;
-
-            // handle array type
-            if(packetType == '*') {
-                if(allElementsCount > 0) allElementsCount--;
-                currentElementCount = length == -1 ? 1 : length + 1;
-                allElementsCount += currentElementCount;
-
-                currentArray = &*response->arrayListRef().insert(--response->arrayListRef().begin(), std::list<QByteArray>());
-
-                // handle null multi bulk by creating single null value in array and exit loop
-                if(length == -1) currentArray->push_back(QByteArray());
-            }
-
-            // if we have a null bulk string, so create a null byte array
-            else if(length == -1) {
-                currentArray->push_back(QByteArray());
-            }
-
-            // otherwise we have normal bulk string, so parse it
-            else {
-                protoSegmentNext = readSegement(&rawData, length + 2);
-                currentArray->push_back(QByteArray(rawData, length));
-                rawData = protoSegmentNext;
-            }
-            if(currentElementCount == 1 && allElementsCount > 1) {
-                currentArray = &*--response->arrayListRef().end();
-                currentElementCount = allElementsCount;
-            }
-        } while(--currentElementCount && --allElementsCount);
-
-        // if we have less or equal one item, return a RedisArray otherwise a RedisArrayList
-        if(response->arrayListRef().size() > 1) response->type(RedisResponseData::Type::ArrayList);
-        else if(response->arrayListRef().size() == 1) {
-            response->array(*response->arrayListRef().begin());
-            response->arrayListRef().clear();
-        }
+    // the handshake reply is received before any other reply
+    if(!this->parseHandshake(socket, waitForData)) return false;
+
+    // parse allready received data first, read more data (and wait for it, if wanted) until the reply is complete
+    RedisResponseParser* parser = this->connection(socket)->parser;
+    // Note: push frames received in between are handed out by redisPushReceived
+    RedisResponseParser::Result result;
+    while((result = parser->parse(response)) == RedisResponseParser::Result::Incomplete || result == RedisResponseParser::Result::Push) {
+        if(result == RedisResponseParser::Result::Push) emit this->redisPushReceived(parser->takePush());
+        else if(!socket->bytesAvailable() && (!waitForData || !socket->waitForReadyRead())) return false;
+        else parser->readFrom(socket);
     }
+    return result == RedisResponseParser::Result::Complete;
+}
 
-    // write not parsed data back to socket
-    for(auto itr = data.end() - 1; itr != rawData - 1; itr--) {
-        socket->ungetChar(*itr);
+RedisServer* RedisServer::decodingNode(const RedisCommand& cmd)
+{
+    // commands of a cluster are executed by the node of their key
+    if(this->boolCluster) {
+        RedisServer* node = this->clusterNode(cmd.key());
+        return node ? node->decodingNode(cmd) : 0;
     }
 
-    // some command based normalizations
-    // [H|S|Z|]SCAN
-    // - move 1. element of 1. arraylist element to cursor and 2. arraylist element to array
-    if(request->cmd() == "SCAN" ||
-       request->cmd() == "HSCAN" ||
-       request->cmd() == "SSCAN" ||
-       request->cmd() == "ZSCAN")
-    {
-        response->cursor(response->arrayListRef().front().front().toInt());
-        response->array(response->arrayListRef().back());
-        response->arrayListRef().clear();
+    // read only commands are served by a replica, if the read policy allows it (writes are tracked for read your writes)
+    if(!this->lstReplicas.isEmpty()) {
+        RedisServer* replica = this->readReplica(cmd);
+        if(replica) return replica;
     }
+    if(this->enumReadPolicy == ReadPolicy::ReadYourWrites && !this->lstReplicas.isEmpty()) this->trackWrite(cmd);
+    return this;
+}
 
-    // everything okay
+RedisServer::RedisResponse RedisServer::executeDecoded(const RedisCommand& cmd, QIODevice*& socket, ElementVisitor visitor)
+{
+    // acquire blocked socket (commands fail fast, while the connection is lost)
+    socket = this->requestConnection(RedisServer::ConnectionType::Blocked, cmd.key());
+    if(!socket || RedisServer::isUnconnected(socket)) return RedisResponse();
+
+    // encode and write RESP request
+    Connection* connection = this->connection(socket);
+    this->encodeCommand(connection->encoder, cmd);
+    bool written = connection->encoder.flush(socket) != -1;
+    connection->encoder.clear();
+    if(!written) return RedisResponse();
+
+    // parse the reply into the reused response of the connection (the elements of a streamed reply are handed to the visitor instead)
+    // Note: a reply, which isn't complete, is still referenced by the parser, so the response isn't reused anymore
+    if(connection->decodedResponse.isNull()) connection->decodedResponse = RedisResponse(new RedisResponseData(socket));
+    RedisResponse response = connection->decodedResponse;
+    if(visitor) connection->parser->stream(visitor);
+    if(this->parseReply(socket, response, true)) return response;
+    connection->parser->stream(ElementVisitor());
+    connection->decodedResponse.clear();
+    return RedisResponse();
+}
+
+bool RedisServer::execStreamed(const RedisCommand& cmd, ElementVisitor visitor)
+{
+    // execute the command on a blocked socket of the node of it's key (or of a replica)
+    QIODevice* socket = 0;
+    RedisServer* node = this->decodingNode(cmd);
+    RedisResponse response = node ? node->executeDecoded(cmd, socket, visitor) : RedisResponse();
+    bool success = !response.isNull() && !response->hasError();
+    bool redirected = this->boolCluster && !response.isNull() && response->hasError() && (response->error().startsWith("MOVED ") || response->error().startsWith("ASK "));
+    if(node) node->releaseDecoded(socket);
+    if(!redirected) return success;
+
+    // redirected commands are executed again as request, which follows the redirect (so the elements of this reply are visited after it's received)
+    RedisRequest request = this->execRedisCommand(cmd, RequestType::Syncron);
+    if(!request->isSuccess() || request->response()->hasError()) return false;
+    RedisResponseArray array = request->response()->array();
+    for(int i = 0; i < array.size() && visitor(array.data(i), array.length(i)); i++);
     return true;
 }
 
-int RedisServer::executePipeline(RequestType type)
+void RedisServer::releaseDecoded(QIODevice* socket)
+{
+    // the receive buffer is released, so that the parser can reuse it for the next reply
+    if(!socket) return;
+    RedisResponse response = this->connection(socket)->decodedResponse;
+    if(!response.isNull()) response->clear();
+    this->freeBlockedConnection(socket);
+}
+
+RedisServer::RedisResponse RedisServer::RedisReply::toResponse() const
 {
-    // exit if we have no pipeline data to write
-    if(this->pendingPipelineRequests.isEmpty()) return 0;
+    // the reply tree of the response is a copy of the subtree of this element (including it's attribute)
+    RedisResponse response(new RedisResponseData(this->_response ? this->_response->socket() : 0));
+    if(!this->isValid()) return response;
+    int begin = this->_attribute == -1 ? this->_index : this->_attribute;
+    std::vector<RedisResponseElement>& elements = response->elementsRef();
+    elements.assign(this->_nodes + begin, this->_nodes + this->_nodes[begin].next);
+    for(auto itr = elements.begin(); itr != elements.end(); itr++) itr->next -= begin;
+    response->buffer(this->_response->_buffer, this->_response->_bufferOffset);
+
+    // top level scalars are stored directly in the response (like the parser does)
+    switch(this->respType()) {
+        case '+': case '$': case '=': response->string(this->string()); break;
+        case '-': case '!': response->error(this->error()); break;
+        case ':': response->integer(this->integer()); break;
+        case '#': response->boolean(this->boolean()); break;
+        case ',': response->real(this->real()); break;
+        case '_':
+            response->string(QByteArray());
+            response->type(RedisResponseData::Type::Null);
+            break;
+        case '(':
+            response->string(this->string());
+            response->type(RedisResponseData::Type::BigNumber);
+            break;
+        case '*': response->type(RedisResponseData::Type::Array); break;
+        case '~': response->type(RedisResponseData::Type::Set); break;
+        case '%': response->type(RedisResponseData::Type::Map); break;
+        case '>': response->type(RedisResponseData::Type::Push); break;
+    }
+    return response;
+}
 
-    // move pipeline requests to pendingRequests and write data to socket
-    int count = this->pendingPipelineRequests.count();
-    this->pendingRequests.append(this->pendingPipelineRequests);
-    this->socketReadWrite->write(this->pendingPipelineData);
-    this->pendingPipelineRequests.clear();
-    this->pendingPipelineData.clear();
+RedisServer::Connection::Connection() : parser(new RedisResponseParser) { }
 
-    // if user want to WriteOnlyBlocked just wait until data was written
-    if(type == RequestType::WriteOnlyBlocked) this->socketReadWrite->waitForBytesWritten();
+RedisServer::Connection::~Connection()
+{
+    delete this->parser;
+}
+
+void RedisServer::Connection::resetParser()
+{
+    // drop partially received replies
+    delete this->parser;
+    this->parser = new RedisResponseParser;
+    this->handshakeResponse.clear();
+}
+
+RedisServer::Connection* RedisServer::connection(QIODevice* socket)
+{
+    // every socket has it's own parser and encoder (including it's own receive and output buffer)
+    Connection* connection = this->hashConnections.value(socket);
+    if(!connection) this->hashConnections.insert(socket, connection = new Connection);
+    return connection;
+}
+
+int RedisServer::executePipeline(RequestType type)
+{
+    // move pipeline requests of every connection to it's pendingRequests and write it's pipeline data to the socket
+    // Note: the nodes of a cluster (and the replicas) write their pipelines first, so that all of them handle their pipelines in parallel
+    int count = 0;
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) count += (*itr)->executePipeline(type == RequestType::Syncron ? RequestType::Asyncron : type);
+    for(auto itr = this->lstReadWriteSockets.begin(); itr != this->lstReadWriteSockets.end(); itr++) {
+        Connection* connection = this->connection(*itr);
+        if(connection->pendingPipelineRequests.isEmpty()) continue;
+        count += connection->pendingPipelineRequests.count();
+
+        // write pipeline data behind all requests, which the connection has encoded allready (so that the replies keep the order of the pending requests)
+        if(connection->boolFlushPending) this->flushConnection(*itr, connection);
+        connection->pendingRequests.append(connection->pendingPipelineRequests);
+        connection->pipeline.flush(*itr);
+        connection->pendingPipelineRequests.clear();
+
+        // if user want to WriteOnlyBlocked just wait until data was written
+        if(type == RequestType::WriteOnlyBlocked) (*itr)->waitForBytesWritten();
+    }
+
+    // exit if we had no pipeline data to write
+    if(!count) return 0;
 
     // if user want to write the data syncron, wait until all pending requests are handled by the server
     else if(type == RequestType::Syncron) {
@@ -344,15 +1226,476 @@ int RedisServer::executePipeline(RequestType type)
     return count;
 }
 
+RedisServer* RedisServer::createChildServer(const QString& host, quint16 port)
+{
+    // a child takes over the options of this server (it's a child object of this server, so it's moved into the io thread with it)
+    RedisServer* server = new RedisServer(host, port, this->enumProtocol, this->enumTransport);
+    server->intReadWriteConnections = this->intReadWriteConnections;
+    server->enumBalancing = this->enumBalancing;
+    server->reconnect(this->boolReconnect, this->intReconnectMaxBackoff, this->boolReplay);
+    server->autoPipelining(this->boolAutoPipelining, this->intAutoPipeliningMaxBytes, this->intAutoPipeliningMaxCommands);
+    server->backpressure(this->intHighInFlight, this->intLowInFlight, this->intHighUnsentBytes, this->intLowUnsentBytes);
+    server->hashScripts = this->hashScripts;
+    server->setParent(this);
+    this->lstChildServers.append(server);
+
+    // signals of the children are signals of this server (all requests are finished, if the requests of all children are finished)
+    QObject::connect(server, &RedisServer::redisResponseFinished, this, &RedisServer::redisResponseFinished);
+    QObject::connect(server, &RedisServer::redisPushReceived, this, &RedisServer::redisPushReceived);
+    QObject::connect(server, &RedisServer::redisBackpressure, this, &RedisServer::redisBackpressure);
+    QObject::connect(server, &RedisServer::redisRequestsFinished, this, [this]() {
+        if(!this->pendingRequestCount()) emit this->redisRequestsFinished();
+    });
+    return server;
+}
+
+void RedisServer::addReplica(QString host, qint16 port)
+{
+    // replicas are probed, as long as there are replicas
+    Replica replica;
+    replica.server = this->createChildServer(host, port);
+    this->lstReplicas.append(replica);
+    if(!this->timerReplicaProbe.isActive()) this->timerReplicaProbe.start(1000);
+}
+
+void RedisServer::readPolicy(ReadPolicy policy, int readYourWritesWindow)
+{
+    this->enumReadPolicy = policy;
+    this->intReadYourWritesWindow = readYourWritesWindow;
+    this->hashRecentWrites.clear();
+}
+
+RedisServer* RedisServer::readReplica(const RedisCommand& cmd)
+{
+    // writes (and all reads of the primary policy) stay on the primary
+    if(this->enumReadPolicy == ReadPolicy::Primary || !RedisServer::isReadOnly(cmd.name)) return 0;
+
+    // keys, which this client has written recently, are read from the primary
+    if(this->enumReadPolicy == ReadPolicy::ReadYourWrites && !cmd.args.empty()) {
+        auto itr = this->hashRecentWrites.find(cmd.key());
+        if(itr != this->hashRecentWrites.end()) {
+            if(itr.value() > this->timerClock.elapsed()) return 0;
+            this->hashRecentWrites.erase(itr);
+        }
+    }
+
+    // use the available replica with the smallest round trip
+    if(this->enumReadPolicy == ReadPolicy::LeastLatency) {
+        Replica* best = 0;
+        for(auto itr = this->lstReplicas.begin(); itr != this->lstReplicas.end(); itr++) {
+            if(itr->boolAvailable && (!best || (itr->intLatency >= 0 && (best->intLatency < 0 || itr->intLatency < best->intLatency)))) best = &(*itr);
+        }
+        return best ? best->server : 0;
+    }
+
+    // otherwise use the next available replica (the primary, if no replica is available)
+    for(int i = 0; i < this->lstReplicas.size(); i++) {
+        const Replica& replica = this->lstReplicas.at(this->intNextReplica++ % this->lstReplicas.size());
+        if(replica.boolAvailable) return replica.server;
+    }
+    return 0;
+}
+
+void RedisServer::trackWrite(const RedisCommand& cmd)
+{
+    // remember the written key until the replicas should have received the write
+    if(cmd.args.empty() || RedisServer::isReadOnly(cmd.name)) return;
+    qint64 now = this->timerClock.elapsed();
+    this->hashRecentWrites.insert(cmd.key(), now + this->intReadYourWritesWindow);
+
+    // drop expired keys, whenever the number of remembered keys has doubled
+    if(this->hashRecentWrites.size() < this->intRecentWritesPruneSize) return;
+    for(auto itr = this->hashRecentWrites.begin(); itr != this->hashRecentWrites.end();) {
+        if(itr.value() <= now) itr = this->hashRecentWrites.erase(itr);
+        else itr++;
+    }
+    this->intRecentWritesPruneSize = qMax(1024, this->hashRecentWrites.size() * 2);
+}
+
+void RedisServer::probeReplicas()
+{
+    // Build and execute Command
+    // PING
+    // src: http://redis.io/commands/ping
+    for(int i = 0; i < this->lstReplicas.size(); i++) {
+        qint64 sent = this->timerClock.nsecsElapsed();
+        RedisServer::RedisRequest request = this->lstReplicas.at(i).server->ping("", RequestType::Asyncron);
+
+        // a replica is available, as long as it answers (the round trip is smoothed over the last probes)
+        request->then([this, i, sent](RedisServer::RedisRequest request) {
+            Replica& replica = this->lstReplicas[i];
+            replica.boolAvailable = request->isSuccess() && !request->response()->hasError();
+            if(!replica.boolAvailable) return;
+            qint64 latency = (this->timerClock.nsecsElapsed() - sent) / 1000;
+            replica.intLatency = replica.intLatency < 0 ? latency : (replica.intLatency * 7 + latency) / 8;
+        }, this);
+    }
+}
+
+QByteArray RedisServer::hashTag(const QByteArray& key)
+{
+    // only the hash tag is hashed, if the key has a non empty one (e.g. {user1000}.following), so that related keys share their slot (or shard)
+    int begin = key.indexOf('{');
+    int end = begin == -1 ? -1 : key.indexOf('}', begin + 1);
+    if(end > begin + 1) return QByteArray::fromRawData(key.constData() + begin + 1, end - begin - 1);
+    return key;
+}
+
+quint16 RedisServer::hashSlot(const QByteArray& key)
+{
+    QByteArray tag = RedisServer::hashTag(key);
+    const char* data = tag.constData();
+    int length = tag.size();
+
+    // CRC16 (XMODEM) of the key modulo 16384
+    // src: http://redis.io/topics/cluster-spec#keys-distribution-model
+    static const std::vector<quint16> table = []() {
+        std::vector<quint16> table(256);
+        for(int i = 0; i < 256; i++) {
+            quint16 crc = i << 8;
+            for(int bit = 0; bit < 8; bit++) crc = crc & 0x8000 ? (crc << 1) ^ 0x1021 : crc << 1;
+            table[i] = crc;
+        }
+        return table;
+    }();
+    quint16 crc = 0;
+    for(int i = 0; i < length; i++) crc = (crc << 8) ^ table[((crc >> 8) ^ (uchar)data[i]) & 0xff];
+    return crc & 16383;
+}
+
+RedisServer* RedisServer::clusterNode(const QByteArray& routingKey)
+{
+    // shards own the keys up to their points on the hash ring (the first point owns the keys behind the last one)
+    if(!this->vecShardRing.empty()) {
+        auto itr = std::lower_bound(this->vecShardRing.begin(), this->vecShardRing.end(), std::make_pair(RedisServer::shardHash(routingKey), (RedisServer*)0));
+        return itr == this->vecShardRing.end() ? this->vecShardRing.front().second : itr->second;
+    }
+
+    // the slot map is discovered on first use, if the connections are not initialized
+    if(this->vecClusterSlots.empty() && !this->discoverSlots()) return 0;
+    return this->vecClusterSlots[RedisServer::hashSlot(routingKey)];
+}
+
+RedisServer* RedisServer::clusterNode(const QString& host, quint16 port)
+{
+    // exit if the node is allready known
+    QString name = host + ":" + QString::number(port);
+    RedisServer* node = this->hashClusterNodes.value(name);
+    if(node) return node;
+    node = this->createChildServer(host, port);
+    this->hashClusterNodes.insert(name, node);
+    return node;
+}
+
+RedisServer* RedisServer::clusterNodeOf(QIODevice* socket)
+{
+    // find the node, the socket belongs to
+    if(!socket) return 0;
+    for(auto itr = this->hashClusterNodes.begin(); itr != this->hashClusterNodes.end(); itr++) {
+        if(itr.value()->hashConnections.contains(socket)) return itr.value();
+    }
+    return 0;
+}
+
+QList<RedisServer*> RedisServer::clusterMasters()
+{
+    // every shard, or every node of the slot map once
+    if(!this->hashShards.isEmpty()) return this->hashShards.keys();
+    QList<RedisServer*> nodes;
+    QSet<RedisServer*> known;
+    for(auto itr = this->vecClusterSlots.begin(); itr != this->vecClusterSlots.end(); itr++) {
+        if(!*itr || known.contains(*itr)) continue;
+        known.insert(*itr);
+        nodes.append(*itr);
+    }
+    return nodes;
+}
+
+void RedisServer::addShard(QString host, qint16 port, int virtualNodes)
+{
+    // the server becomes a facade of it's shards, which are routed like the nodes of a cluster
+    RedisServer* node = this->clusterNode(host, port);
+    this->hashShards.insert(node, qMax(virtualNodes, 1));
+    this->boolCluster = true;
+    this->buildShardRing();
+}
+
+void RedisServer::removeShard(QString host, qint16 port)
+{
+    // the node is kept (so that pending requests are still answered), but doesn't own keys anymore
+    RedisServer* node = this->hashClusterNodes.value(host + ":" + QString::number(port));
+    if(!node || !this->hashShards.remove(node)) return;
+    if(this->hashShards.isEmpty()) this->boolCluster = false;
+    this->buildShardRing();
+}
+
+void RedisServer::buildShardRing()
+{
+    // every shard owns virtualNodes points of the ring, which only depend on it's own address
+    // Note: so adding or removing a shard only moves the keys of the points of this shard (about 1/N of the keys)
+    std::vector<std::pair<quint32, RedisServer*>> ring;
+    for(auto itr = this->hashShards.begin(); itr != this->hashShards.end(); itr++) {
+        QByteArray name = (itr.key()->strRedisConnectionHost + ":" + QString::number(itr.key()->intRedisConnectionPort)).toUtf8();
+        for(int i = 0; i < itr.value(); i++) ring.push_back(std::make_pair(RedisServer::shardHash(name + "-" + QByteArray::number(i)), itr.key()));
+    }
+    std::sort(ring.begin(), ring.end());
+    this->vecShardRing.swap(ring);
+}
+
+quint32 RedisServer::shardHash(const QByteArray& key)
+{
+    // FNV-1a of the hash tag, mixed by the murmur3 finalizer (so that similar keys are spread over the whole ring)
+    QByteArray tag = RedisServer::hashTag(key);
+    quint32 hash = 2166136261u;
+    for(int i = 0; i < tag.size(); i++) hash = (hash ^ (uchar)tag.at(i)) * 16777619u;
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+bool RedisServer::discoverSlots()
+{
+    // ask the configured server first, then every other known node
+    QList<RedisServer*> nodes;
+    nodes.append(this->clusterNode(this->strRedisConnectionHost, this->intRedisConnectionPort));
+    for(auto itr = this->hashClusterNodes.begin(); itr != this->hashClusterNodes.end(); itr++) {
+        if(!nodes.contains(itr.value())) nodes.append(itr.value());
+    }
+
+    // Build and execute Command
+    // CLUSTER SLOTS
+    // src: http://redis.io/commands/cluster-slots
+    for(auto itr = nodes.begin(); itr != nodes.end(); itr++) {
+        RedisServer::RedisRequest request = (*itr)->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$7\r\nCLUSTER\r\n$5\r\nSLOTS\r\n"), "CLUSTER", {}), RequestType::Syncron);
+        if(request->isSuccess() && !request->response()->hasError() && this->applySlots(request->response()->reply(), (*itr)->strRedisConnectionHost)) return true;
+    }
+    qWarning("Cannot discover the slots of Redis Cluster %s:%i...", qPrintable(this->strRedisConnectionHost), this->intRedisConnectionPort);
+    return false;
+}
+
+bool RedisServer::applySlots(const RedisReply& reply, const QString& defaultHost)
+{
+    // [[start, end, [host, port, id], replicas...], ...]
+    // Note: an empty host stands for the host of the node, which sent the slot map
+    if(!reply.isArray() || !reply.size()) return false;
+    std::vector<RedisServer*> vecSlots(16384, 0);
+    for(auto itr = reply.begin(); itr != reply.end(); itr++) {
+        RedisReply range = *itr;
+        RedisReply master = range.at(2);
+        if(master.size() < 2) continue;
+        QString host = master.at(0).string();
+        RedisServer* node = this->clusterNode(host.isEmpty() || host == "?" ? defaultHost : host, master.at(1).integer());
+        for(qint64 slot = qMax(range.at(0).integer(), (qint64)0); slot <= range.at(1).integer() && slot < 16384; slot++) vecSlots[slot] = node;
+    }
+    this->vecClusterSlots.swap(vecSlots);
+    return true;
+}
+
+void RedisServer::scheduleSlotsRefresh()
+{
+    // the slot map is refreshed once for all redirects of one event loop iteration
+    if(this->boolSlotsRefreshPending) return;
+    this->boolSlotsRefreshPending = true;
+    QMetaObject::invokeMethod(this, "refreshSlots", Qt::QueuedConnection);
+}
+
+void RedisServer::refreshSlots()
+{
+    // Build and execute Command
+    // CLUSTER SLOTS
+    // src: http://redis.io/commands/cluster-slots
+    RedisServer* node = this->vecClusterSlots.empty() ? 0 : this->vecClusterSlots.front();
+    if(!node) node = this->clusterNode(this->strRedisConnectionHost, this->intRedisConnectionPort);
+    QString host = node->strRedisConnectionHost;
+    RedisServer::RedisRequest request = node->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$7\r\nCLUSTER\r\n$5\r\nSLOTS\r\n"), "CLUSTER", {}), RequestType::Asyncron);
+    request->then([this, host](RedisServer::RedisRequest request) {
+        this->boolSlotsRefreshPending = false;
+        if(request->isSuccess() && !request->response()->hasError()) this->applySlots(request->response()->reply(), host);
+    }, this);
+}
+
+void RedisServer::executeClusterRequest(RedisServer::RedisRequest& request, const RedisCommand& cmd, QIODevice* socket)
+{
+    // requests on a given socket are executed by the node of the socket, otherwise by the node of the slot of their key
+    RedisServer* node = socket ? this->clusterNodeOf(socket) : this->clusterNode(cmd.key());
+    if(!node) {
+        request->cmd(cmd.name);
+        request->error("No Cluster Node");
+        request->finish(false);
+        return;
+    }
+
+    // requests, which receive a reply, follow redirects
+    RequestType type = request->type();
+    if(type == RequestType::Syncron || type == RequestType::Asyncron || type == RequestType::PipeLine) this->enableRedirect(request, cmd);
+    node->executeRequest(request, cmd, socket);
+}
+
+void RedisServer::enableRedirect(RedisServer::RedisRequest& request, const RedisCommand& cmd)
+{
+    // the command is kept until the request is finished (a previous hook of the request is called, if the request isn't redirected)
+    std::function<bool(RedisServer::RedisRequest)> previous = request->_redirect;
+    request->_redirect = [this, cmd, previous](RedisServer::RedisRequest request) { return this->redirectRequest(request, cmd) || (previous && previous(request)); };
+}
+
+bool RedisServer::redirectRequest(RedisServer::RedisRequest& request, const RedisCommand& cmd)
+{
+    // only MOVED and ASK errors are redirected (a redirect loop is stopped after 5 redirects)
+    RedisResponse response = request->response();
+    if(!response->hasError() || request->_redirects >= 5) return false;
+    bool asking;
+    RedisServer* node = this->redirectNode(response, asking);
+    if(!node) return false;
+    request->_redirects++;
+
+    // the request is executed again with an empty response (redirected pipeline requests are executed asyncron)
+    QByteArray key = cmd.key();
+    if(request->_type == RequestType::PipeLine) request->_type = RequestType::Asyncron;
+    request->error(QString());
+    request->response(RedisResponse(new RedisResponseData(0)));
+    request->socket(0);
+    if(!asking) {
+        node->executeRequest(request, cmd, 0);
+        return true;
+    }
+
+    // ASKING has to be sent right before the request on the same connection
+    // src: http://redis.io/topics/cluster-spec#ask-redirection
+    RedisCommand askingCmd(QByteArrayLiteral("*1\r\n$6\r\nASKING\r\n"), "ASKING", {});
+    if(request->_type == RequestType::Syncron) {
+        QIODevice* socket = node->requestConnection(RedisServer::ConnectionType::Blocked, key);
+        QList<RedisServer::RedisRequest> requests { RedisServer::RedisRequest(new RedisRequestData(RequestType::Syncron, socket)), request };
+        RedisCommandEncoder& encoder = node->connection(socket)->encoder;
+        node->encodeCommand(encoder, askingCmd);
+        node->encodeCommand(encoder, cmd);
+        node->executeBatch(requests, encoder, socket);
+        node->freeBlockedConnection(socket);
+    } else {
+        QIODevice* socket = node->requestConnection(RedisServer::ConnectionType::ReadWrite, key);
+        node->execRedisCommand(askingCmd, RequestType::Asyncron, socket);
+        request->socket(socket);
+        node->executeRequest(request, cmd, socket);
+    }
+    return true;
+}
+
+RedisServer* RedisServer::redirectNode(RedisResponse response, bool& asking)
+{
+    // MOVED <slot> <host>:<port> or ASK <slot> <host>:<port>
+    QString error = response->error();
+    asking = error.startsWith("ASK ");
+    if(!asking && !error.startsWith("MOVED ")) return 0;
+    int slotPos = asking ? 4 : 6;
+    int hostPos = error.indexOf(" ", slotPos) + 1;
+    int portPos = error.lastIndexOf(':') + 1;
+    if(!hostPos || portPos <= hostPos) return 0;
+    int slot = error.mid(slotPos, hostPos - slotPos - 1).toInt();
+    QString host = error.mid(hostPos, portPos - hostPos - 1);
+    RedisServer* node = this->clusterNode(host.isEmpty() ? this->strRedisConnectionHost : host, error.mid(portPos).toUShort());
+
+    // a moved slot belongs to the new node instantly, the rest of the slot map is refreshed asyncron
+    // Note: an ASK redirect is only valid for the redirected request, the slot is still served by the old node
+    if(!asking && slot >= 0 && slot < (int)this->vecClusterSlots.size()) {
+        this->vecClusterSlots[slot] = node;
+        this->scheduleSlotsRefresh();
+    }
+    return node;
+}
+
 RedisServer::RedisRequest RedisServer::ping(QByteArray data, RequestType type)
 {
     // Build and execute Command
     // PING [data]
     // src: http://redis.io/commands/ping
-    std::list<QByteArray> lstCmd = { "PING" };
-    if(!data.isEmpty()) lstCmd.push_back(data);
+    if(data.isEmpty()) return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*1\r\n$4\r\nPING\r\n"), "PING", {}), type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$4\r\nPING\r\n"), "PING", { data }), type);
+}
 
-    return this->execRedisCommand(lstCmd, type);
+QByteArray RedisServer::loadScript(const QByteArray& script)
+{
+    // scripts are known by their SHA1 (like the server computes it), a script is loaded only once
+    QByteArray sha = QCryptographicHash::hash(script, QCryptographicHash::Sha1).toHex();
+    if(this->hashScripts.contains(sha)) return sha;
+    this->hashScripts.insert(sha, script);
+    for(auto itr = this->lstChildServers.begin(); itr != this->lstChildServers.end(); itr++) (*itr)->hashScripts.insert(sha, script);
+
+    // Build and execute Command
+    // SCRIPT LOAD script
+    // src: http://redis.io/commands/script-load
+    // Note: every known node of a cluster loads the script (other nodes execute it by EVAL on first use)
+    QList<RedisServer*> nodes;
+    if(!this->boolCluster) nodes.append(this);
+    else nodes = this->clusterMasters();
+    for(auto itr = nodes.begin(); itr != nodes.end(); itr++) (*itr)->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$6\r\nSCRIPT\r\n$4\r\nLOAD\r\n"), "SCRIPT", { script }), RequestType::Asyncron);
+    return sha;
+}
+
+RedisServer::RedisRequest RedisServer::evalScript(const QByteArray& sha, std::list<QByteArray> keys, std::list<QByteArray> args, RequestType type)
+{
+    // Build and execute Command
+    // EVALSHA sha numkeys [ key ] ... [ arg ] ...
+    // src: http://redis.io/commands/evalsha
+    std::vector<QByteArray> cmdArgs;
+    cmdArgs.reserve(2 + keys.size() + args.size());
+    cmdArgs.push_back(sha);
+    cmdArgs.push_back(QByteArray::number((int)keys.size()));
+    cmdArgs.insert(cmdArgs.end(), keys.begin(), keys.end());
+    cmdArgs.insert(cmdArgs.end(), args.begin(), args.end());
+    RedisCommand cmd(QByteArrayLiteral("$7\r\nEVALSHA\r\n"), "EVALSHA", cmdArgs);
+
+    // Build Command
+    // EVAL script numkeys [ key ] ... [ arg ] ...
+    // src: http://redis.io/commands/eval
+    cmdArgs[0] = this->hashScripts.value(sha);
+    RedisCommand evalCmd(QByteArrayLiteral("$4\r\nEVAL\r\n"), "EVAL", cmdArgs);
+    if(cmdArgs[0].isNull()) return this->execRedisCommand(cmd, type);
+
+    // a transaction can't execute the script again, so it's always executed by EVAL
+    if(type == RequestType::PipeLine && this->transactionTarget) return this->execRedisCommand(evalCmd, type);
+    if(type == RequestType::PipeLine && this->pipelineTarget) {
+        RedisServer::RedisRequest request = this->pipelineTarget->exec(cmd);
+        this->enableScriptFallback(request, evalCmd);
+        return request;
+    }
+    RedisServer::RedisRequest request(new RedisRequestData(type, 0));
+    if(type != RequestType::WriteOnly && type != RequestType::WriteOnlyBlocked) this->enableScriptFallback(request, evalCmd);
+    this->executeRequest(request, cmd, 0);
+    return request;
+}
+
+void RedisServer::enableScriptFallback(RedisServer::RedisRequest& request, const RedisCommand& evalCmd)
+{
+    // the request is executed again by EVAL, if the script cache of the server misses the script (a previous hook of the request is called first)
+    std::function<bool(RedisServer::RedisRequest)> previous = request->_redirect;
+    request->_redirect = [this, evalCmd, previous](RedisServer::RedisRequest request) {
+        if(previous && previous(request)) return true;
+        if(!request->response()->hasError() || !request->response()->error().startsWith("NOSCRIPT")) return false;
+        request->_redirect = previous;
+        if(request->_type == RequestType::PipeLine) request->_type = RequestType::Asyncron;
+        request->error(QString());
+        request->response(RedisResponse(new RedisResponseData(0)));
+        request->socket(0);
+        this->executeRequest(request, evalCmd, 0);
+        return true;
+    };
+}
+
+void RedisServer::reloadScripts(QIODevice* socket)
+{
+    // Build and execute Command
+    // SCRIPT LOAD script
+    // src: http://redis.io/commands/script-load
+    // Note: the requests are pending in front of all other requests of the connection, so their replies are handled first
+    Connection* connection = this->connection(socket);
+    for(auto itr = this->hashScripts.begin(); itr != this->hashScripts.end(); itr++) {
+        RedisServer::RedisRequest request(new RedisRequestData(RequestType::Asyncron, socket));
+        request->cmd("SCRIPT");
+        this->encodeCommand(connection->encoder, RedisCommand(QByteArrayLiteral("*3\r\n$6\r\nSCRIPT\r\n$4\r\nLOAD\r\n"), "SCRIPT", { itr.value() }));
+        connection->pendingRequests.enqueue(request);
+    }
 }
 
 RedisServer::RedisRequest RedisServer::del(QByteArray key, RequestType type)
@@ -360,7 +1703,8 @@ RedisServer::RedisRequest RedisServer::del(QByteArray key, RequestType type)
     // Build and execute Command
     // DEL List
     // src: http://redis.io/commands/del
-    return this->execRedisCommand({"DEL", key }, type);
+    this->invalidateClientCache(key);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$3\r\nDEL\r\n"), "DEL", { key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::exists(QByteArray key, RequestType type)
@@ -368,7 +1712,7 @@ RedisServer::RedisRequest RedisServer::exists(QByteArray key, RequestType type)
     // Build and execute Command
     // EXISTS list
     // src: http://redis.io/commands/exists
-    return this->execRedisCommand({"EXISTS", key }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$6\r\nEXISTS\r\n"), "EXISTS", { key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::keys(QByteArray pattern, RequestType type)
@@ -376,12 +1720,15 @@ RedisServer::RedisRequest RedisServer::keys(QByteArray pattern, RequestType type
     // Build and execute Command
     // KEYS pattern
     // src: http://redis.io/commands/KEYS
-    return this->execRedisCommand({"KEYS", pattern }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$4\r\nKEYS\r\n"), "KEYS", { pattern }), type);
 }
 
 RedisServer::RedisRequest RedisServer::lpush(QByteArray key, QByteArray value, RequestType type)
 {
-    return RedisServer::lpush(key, std::list<QByteArray>{value}, type);
+    // Build and execute Command
+    // LPUSH key value
+    // src: http://redis.io/commands/lpush
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$5\r\nLPUSH\r\n"), "LPUSH", { key, value }), type);
 }
 
 RedisServer::RedisRequest RedisServer::lpush(QByteArray key, std::list<QByteArray> values, RequestType type)
@@ -389,16 +1736,21 @@ RedisServer::RedisRequest RedisServer::lpush(QByteArray key, std::list<QByteArra
     // Build and execute Command
     // LPUSH key value [value]...
     // src: http://redis.io/commands/lpush
-    values.push_front(key);
-    values.push_front("LPUSH");
+    std::vector<QByteArray> args;
+    args.reserve(1 + values.size());
+    args.push_back(key);
+    args.insert(args.end(), values.begin(), values.end());
 
     // exec async
-    return this->execRedisCommand(values, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nLPUSH\r\n"), "LPUSH", args), type);
 }
 
 RedisServer::RedisRequest RedisServer::rpush(QByteArray key, QByteArray value, RequestType type)
 {
-    return RedisServer::rpush(key, std::list<QByteArray>{value}, type);
+    // Build and execute Command
+    // RPUSH key value
+    // src: http://redis.io/commands/rpush
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$5\r\nRPUSH\r\n"), "RPUSH", { key, value }), type);
 }
 
 RedisServer::RedisRequest RedisServer::rpush(QByteArray key, std::list<QByteArray> values, RequestType type)
@@ -406,29 +1758,31 @@ RedisServer::RedisRequest RedisServer::rpush(QByteArray key, std::list<QByteArra
     // Build and execute Command
     // RPUSH key value [value]...
     // src: http://redis.io/commands/rpush
-    values.push_front(key);
-    values.push_front("RPUSH");
+    std::vector<QByteArray> args;
+    args.reserve(1 + values.size());
+    args.push_back(key);
+    args.insert(args.end(), values.begin(), values.end());
 
     // exec async
-    return this->execRedisCommand(values, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nRPUSH\r\n"), "RPUSH", args), type);
 }
 
-RedisServer::RedisRequest RedisServer::blpop(QTcpSocket *socket, std::list<QByteArray> lists, int timeout, RequestType type)
+RedisServer::RedisRequest RedisServer::blpop(QIODevice *socket, std::list<QByteArray> lists, int timeout, RequestType type)
 {
     // Build and execute Command
     // src: http://redis.io/commands/BLPOP lists timeout
-    lists.push_front("BLPOP");
-    lists.push_back(QByteArray::number(timeout));
-    return this->execRedisCommand(lists, type, socket);
+    std::vector<QByteArray> args(lists.begin(), lists.end());
+    args.push_back(QByteArray::number(timeout));
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nBLPOP\r\n"), "BLPOP", args), type, socket);
 }
 
-RedisServer::RedisRequest RedisServer::brpop(QTcpSocket *socket, std::list<QByteArray> lists, int timeout, RequestType type)
+RedisServer::RedisRequest RedisServer::brpop(QIODevice *socket, std::list<QByteArray> lists, int timeout, RequestType type)
 {
     // Build and execute Command
     // src: http://redis.io/commands/BRPOP lists timeout
-    lists.push_front("BRPOP");
-    lists.push_back(QByteArray::number(timeout));
-    return this->execRedisCommand(lists, type, socket);
+    std::vector<QByteArray> args(lists.begin(), lists.end());
+    args.push_back(QByteArray::number(timeout));
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nBRPOP\r\n"), "BRPOP", args), type, socket);
 }
 
 RedisServer::RedisRequest RedisServer::llen(QByteArray key, RequestType type)
@@ -436,7 +1790,7 @@ RedisServer::RedisRequest RedisServer::llen(QByteArray key, RequestType type)
     // Build and execute Command
     // LLEN key
     // src: http://redis.io/commands/llen
-    return this->execRedisCommand({"LLEN", key}, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$4\r\nLLEN\r\n"), "LLEN", { key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hlen(QByteArray list, RequestType type)
@@ -444,7 +1798,7 @@ RedisServer::RedisRequest RedisServer::hlen(QByteArray list, RequestType type)
     // Build and execute Command
     // HLEN list
     // src: http://redis.io/commands/hlen
-    return this->execRedisCommand({"HLEN", list}, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$4\r\nHLEN\r\n"), "HLEN", { list }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hset(QByteArray list, QByteArray key, QByteArray value, RequestType type)
@@ -452,7 +1806,8 @@ RedisServer::RedisRequest RedisServer::hset(QByteArray list, QByteArray key, QBy
     // Build and execute Command
     // HSET list key value
     // src: http://redis.io/commands/hset
-    return this->execRedisCommand({ "HSET", list, key, value }, type);
+    this->invalidateClientCache(list);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*4\r\n$4\r\nHSET\r\n"), "HSET", { list, key, value }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hsetnx(QByteArray list, QByteArray key, QByteArray value, RequestType type)
@@ -460,7 +1815,8 @@ RedisServer::RedisRequest RedisServer::hsetnx(QByteArray list, QByteArray key, Q
     // Build and execute Command
     // HSETNX list key value
     // src: http://redis.io/commands/hsetnx
-    return this->execRedisCommand({ "HSETNX", list, key, value }, type);
+    this->invalidateClientCache(list);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*4\r\n$6\r\nHSETNX\r\n"), "HSETNX", { list, key, value }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hmset(QByteArray list, std::list<QByteArray> keys, std::list<QByteArray> values, RequestType type)
@@ -469,16 +1825,19 @@ RedisServer::RedisRequest RedisServer::hmset(QByteArray list, std::list<QByteArr
     // HMSET list key value [ key value ] ...
     // src: http://redis.io/commands/hmset
     if(keys.size() != values.size()) return RedisServer::RedisRequest(new RedisRequestData(type, "key/value size is different!"));
-    std::list<QByteArray> lstCmd = { "HMSET", list };
+    std::vector<QByteArray> args;
+    args.reserve(1 + keys.size() * 2);
+    args.push_back(list);
     auto itrKey = keys.begin();
     auto itrValue = values.begin();
     for(;itrKey != keys.end();) {
-        lstCmd.push_back(*itrKey++);
-        lstCmd.push_back(*itrValue++);
+        args.push_back(*itrKey++);
+        args.push_back(*itrValue++);
     }
 
     // execute
-    return this->execRedisCommand(lstCmd, type);
+    this->invalidateClientCache(list);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nHMSET\r\n"), "HMSET", args), type);
 }
 
 RedisServer::RedisRequest RedisServer::hmset(QByteArray list, std::map<QByteArray, QByteArray> entries, RequestType type)
@@ -486,14 +1845,17 @@ RedisServer::RedisRequest RedisServer::hmset(QByteArray list, std::map<QByteArra
     // Build and execute Command
     // HMSET list key value [ key value ] ...
     // src: http://redis.io/commands/hmset
-    std::list<QByteArray> lstCmd = { "HMSET", list };
+    std::vector<QByteArray> args;
+    args.reserve(1 + entries.size() * 2);
+    args.push_back(list);
     for(auto itr = entries.begin(); itr != entries.end(); itr++) {
-        lstCmd.push_back(itr->first);
-        lstCmd.push_back(itr->second);
+        args.push_back(itr->first);
+        args.push_back(itr->second);
     }
 
     // execute
-    return this->execRedisCommand(lstCmd, type);
+    this->invalidateClientCache(list);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nHMSET\r\n"), "HMSET", args), type);
 }
 
 RedisServer::RedisRequest RedisServer::hexists(QByteArray list, QByteArray key, RequestType type)
@@ -501,7 +1863,7 @@ RedisServer::RedisRequest RedisServer::hexists(QByteArray list, QByteArray key,
     // Build and execute Command
     // HEXISTS list key
     // src: http://redis.io/commands/hexists
-    return this->execRedisCommand({ "HEXISTS", list, key }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$7\r\nHEXISTS\r\n"), "HEXISTS", { list, key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hdel(QByteArray list, QByteArray key, RequestType type)
@@ -509,7 +1871,8 @@ RedisServer::RedisRequest RedisServer::hdel(QByteArray list, QByteArray key, Req
     // Build and execute Command
     // HDEL list key
     // src: http://redis.io/commands/hdel
-    return this->execRedisCommand({ "HDEL", list, key}, type);
+    this->invalidateClientCache(list);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$4\r\nHDEL\r\n"), "HDEL", { list, key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hget(QByteArray list, QByteArray key, RequestType type)
@@ -517,7 +1880,7 @@ RedisServer::RedisRequest RedisServer::hget(QByteArray list, QByteArray key, Req
     // Build and execute Command
     // HGET list key
     // src: http://redis.io/commands/hget
-    return this->execRedisCommand({ "HGET", list, key }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$4\r\nHGET\r\n"), "HGET", { list, key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hgetall(QByteArray list, RequestType type)
@@ -525,7 +1888,7 @@ RedisServer::RedisRequest RedisServer::hgetall(QByteArray list, RequestType type
     // Build and execute Command
     // HGETALL list
     // src: http://redis.io/commands/hgetall
-    return this->execRedisCommand({ "HGETALL", list}, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$7\r\nHGETALL\r\n"), "HGETALL", { list }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hmget(QByteArray list, std::list<QByteArray> keys, RequestType type)
@@ -533,9 +1896,11 @@ RedisServer::RedisRequest RedisServer::hmget(QByteArray list, std::list<QByteArr
     // Build and execute Command
     // HMGET list [ key ] ...
     // src: http://redis.io/commands/hmget
-    keys.push_front(list);
-    keys.push_front("HMGET");
-    return this->execRedisCommand(keys, type);
+    std::vector<QByteArray> args;
+    args.reserve(1 + keys.size());
+    args.push_back(list);
+    args.insert(args.end(), keys.begin(), keys.end());
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("$5\r\nHMGET\r\n"), "HMGET", args), type);
 }
 
 RedisServer::RedisRequest RedisServer::hstrlen(QByteArray list, QByteArray key, RequestType type)
@@ -543,7 +1908,7 @@ RedisServer::RedisRequest RedisServer::hstrlen(QByteArray list, QByteArray key,
     // Build and execute Command
     // HSTRLEN key field
     // src: http://redis.io/commands/hstrlen
-    return this->execRedisCommand({ "HSTRLEN", list, key }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*3\r\n$7\r\nHSTRLEN\r\n"), "HSTRLEN", { list, key }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hkeys(QByteArray list, RequestType type)
@@ -551,7 +1916,7 @@ RedisServer::RedisRequest RedisServer::hkeys(QByteArray list, RequestType type)
     // Build and execute Command
     // HKEYS list
     // src: http://redis.io/commands/hkeys
-    return this->execRedisCommand({ "HKEYS", list }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHKEYS\r\n"), "HKEYS", { list }), type);
 }
 
 RedisServer::RedisRequest RedisServer::hvals(QByteArray list, RequestType type)
@@ -559,7 +1924,7 @@ RedisServer::RedisRequest RedisServer::hvals(QByteArray list, RequestType type)
     // Build and execute Command
     // HVALS list
     // src: http://redis.io/commands/hvals
-    return this->execRedisCommand({ "HVALS", list }, type);
+    return this->execRedisCommand(RedisCommand(QByteArrayLiteral("*2\r\n$5\r\nHVALS\r\n"), "HVALS", { list }), type);
 }
 
 RedisServer::RedisRequest RedisServer::scan(QByteArray cursor, int count, QByteArray pattern, RequestType type)
@@ -587,30 +1952,80 @@ RedisServer::RedisRequest RedisServer::scan(QByteArray scanType, QByteArray key,
     // Build and execute Command
     // [|S|H|Z]SCAN cursor [MATCH pattern] [COUNT count]
     // src: http://redis.io/commands/scan
-    std::list<QByteArray> lstCmd = { scanType };
+    std::vector<QByteArray> args;
+    args.reserve(6);
     if(!key.isEmpty()) {
-        lstCmd.push_back(key);
+        args.push_back(key);
     }
-    lstCmd.push_back(cursor);
+    args.push_back(cursor);
     if(!pattern.isEmpty()) {
-        lstCmd.push_back("MATCH");
-        lstCmd.push_back(pattern);
+        args.push_back("MATCH");
+        args.push_back(pattern);
     }
     if(count != -1) {
-        lstCmd.push_back("COUNT");
-        lstCmd.push_back(QByteArray::number(count));
+        args.push_back("COUNT");
+        args.push_back(QByteArray::number(count));
+    }
+    return this->execRedisCommand(RedisCommand(scanType, args), type);
+}
+
+void RedisServer::drainInvalidations()
+{
+    // handle received invalidations without blocking (readyRead may be emitted by waitForReadyRead, so handleInvalidation may run twice)
+    if(!this->socketInvalidation || !this->clientCacheInstance) return;
+    if(this->socketInvalidation->bytesAvailable() > 0 || this->socketInvalidation->waitForReadyRead(0)) this->handleInvalidation();
+}
+
+void RedisServer::handleInvalidation()
+{
+    if(!this->socketInvalidation || !this->clientCacheInstance) return;
+
+    // read all available invalidation messages
+    // Note: RESP3 connections receive "invalidate keys" push frames, RESP2 connections receive "message __redis__:invalidate keys" messages
+    RedisResponseParser* parser = this->connection(this->socketInvalidation)->parser;
+    parser->readFrom(this->socketInvalidation);
+    while(parser->hasPendingData()) {
+        if(this->invalidationResponse.isNull()) this->invalidationResponse = RedisResponse(new RedisResponseData(this->socketInvalidation));
+        RedisResponseParser::Result result = parser->parse(this->invalidationResponse);
+        if(result == RedisResponseParser::Result::Incomplete) break;
+        RedisServer::RedisReply message = result == RedisResponseParser::Result::Push ? parser->takePush()->reply() : this->invalidationResponse->reply();
+        if(result != RedisResponseParser::Result::Push) this->invalidationResponse.clear();
+
+        // invalidate all keys of the message (a null key list means, that all keys became invalid, e.g. on FLUSHALL)
+        QByteArray type = message.at(0).rawString();
+        if(type != "invalidate" && type != "message") continue;
+        RedisServer::RedisReply keys = message.at(message.size() - 1);
+        if(keys.isNull() || !keys.isAggregate()) this->clientCacheInstance->clear();
+        else for(RedisServer::RedisReply key : keys) this->clientCacheInstance->invalidate(key.rawString());
     }
-    return this->execRedisCommand(lstCmd, type);
 }
 
 void RedisServer::handleRedisResponse()
 {
-    if(!this->socketReadWrite) return;
-    while(this->socketReadWrite->bytesAvailable()) {
-        if(this->pendingRequests.isEmpty()) qDebug() << "No pending Requests available!!";
-        RedisServer::RedisRequest request = this->pendingRequests.dequeue();
-        bool result = this->parseResponse(request);
-        this->redisResponseFinished(request, result);
+    // every read/write connection of the pool has it's own queue of pending requests
+    QIODevice* socket = qobject_cast<QIODevice*>(this->sender());
+    if(!socket) return;
+    Connection* connection = this->connection(socket);
+
+    // read all available data at once and handle all complete replies
+    // Note: an incomplete reply stays in the parser until the next readyRead
+    // Note: push frames are no replies to pending requests, so they are handed out by redisPushReceived
+    RedisResponseParser* parser = connection->parser;
+    parser->readFrom(socket);
+    if(!this->parseHandshake(socket, false)) return;
+    while(parser->hasPendingData()) {
+        RedisServer::RedisRequest request = connection->pendingRequests.isEmpty() ? RedisServer::RedisRequest(new RedisRequestData(RequestType::Asyncron, socket)) : connection->pendingRequests.head();
+        RedisResponseParser::Result result = parser->parse(request->response());
+        if(result == RedisResponseParser::Result::Incomplete) break;
+        else if(result == RedisResponseParser::Result::Push) emit this->redisPushReceived(parser->takePush());
+        else if(connection->pendingRequests.isEmpty()) qDebug() << "No pending Requests available!!";
+        else {
+            connection->pendingRequests.dequeue();
+            this->finishRequest(request, result == RedisResponseParser::Result::Complete);
+        }
     }
-    if(this->pendingRequests.isEmpty()) emit this->redisRequestsFinished();
+
+    // all requests of all connections are finished
+    if(connection->pendingRequests.isEmpty() && !this->pendingRequestCount()) emit this->redisRequestsFinished();
+    if(this->boolPaused) this->checkBackpressure();
 }
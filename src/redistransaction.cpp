@@ -0,0 +1,146 @@
+#include "redust/redistransaction.h"
+
+RedisTransaction::RedisTransaction(RedisServer &server, const QByteArray& routingKey)
+{
+    // the transaction is executed by the node of the routing key (on it's own blocked connection)
+    this->server = &server;
+    this->node = server.isCluster() ? server.clusterNode(routingKey) : &server;
+    if(this->node) this->socketTarget = this->node->requestConnection(RedisServer::ConnectionType::Blocked, routingKey);
+}
+
+RedisTransaction::~RedisTransaction()
+{
+    // uncommitted commands are never executed
+    this->discard();
+    if(this->socketTarget) this->node->freeBlockedConnection(this->socketTarget);
+}
+
+bool RedisTransaction::watch(const std::list<QByteArray>& keys)
+{
+    // Build and execute Command
+    // WATCH key [ key ] ...
+    // src: http://redis.io/commands/watch
+    if(!this->socketTarget || keys.empty()) return false;
+    std::vector<RedisServer::RedisCommand> cmds { RedisServer::RedisCommand(QByteArrayLiteral("$5\r\nWATCH\r\n"), "WATCH", std::vector<QByteArray>(keys.begin(), keys.end())) };
+    RedisServer::RedisRequest request = this->node->execRedisCommands(cmds, this->socketTarget).front();
+    if(!request->isSuccess() || request->response()->hasError()) return false;
+    this->boolWatching = true;
+    return true;
+}
+
+RedisServer::RedisRequest RedisTransaction::exec(const std::list<QByteArray>& cmd)
+{
+    // split the command into name and arguments
+    if(cmd.empty()) return RedisServer::RedisRequest(new RedisServer::RedisRequestData(RedisServer::RequestType::Syncron, "Empty Command"));
+    return this->exec(RedisServer::RedisCommand(cmd.front(), std::vector<QByteArray>(++cmd.begin(), cmd.end())));
+}
+
+RedisServer::RedisRequest RedisTransaction::exec(const RedisServer::RedisCommand& cmd)
+{
+    // check socket
+    RedisServer::RedisRequest request(new RedisServer::RedisRequestData(RedisServer::RequestType::Syncron, this->socketTarget));
+    request->cmd(cmd.name);
+    if(!this->socketTarget) {
+        request->error("No Socket");
+        request->finish(false);
+        return request;
+    }
+
+    // Build Command
+    // MULTI (in front of the first command)
+    // src: http://redis.io/commands/multi
+    if(this->lstQueuedRequests.isEmpty()) {
+        this->node->encodeCommand(this->encoder, RedisServer::RedisCommand(QByteArrayLiteral("*1\r\n$5\r\nMULTI\r\n"), "MULTI", {}));
+        this->lstQueuedRequests.append(RedisServer::RedisRequest(new RedisServer::RedisRequestData(RedisServer::RequestType::Syncron, this->socketTarget)));
+    }
+
+    // encode RESP request into the output buffer of this transaction (it's reply is QUEUED, the result is part of the EXEC reply)
+    this->node->encodeCommand(this->encoder, cmd);
+    this->lstQueuedRequests.append(RedisServer::RedisRequest(new RedisServer::RedisRequestData(RedisServer::RequestType::Syncron, this->socketTarget)));
+    this->lstRequests.append(request);
+    return request;
+}
+
+bool RedisTransaction::commit()
+{
+    // an empty transaction just releases the watched keys
+    this->boolAborted = false;
+    if(this->lstRequests.isEmpty()) {
+        this->discard();
+        return true;
+    }
+
+    // Build and execute Command
+    // EXEC
+    // src: http://redis.io/commands/exec
+    RedisServer::RedisRequest request(new RedisServer::RedisRequestData(RedisServer::RequestType::Syncron, this->socketTarget));
+    request->cmd("EXEC");
+    this->node->encodeCommand(this->encoder, RedisServer::RedisCommand(QByteArrayLiteral("*1\r\n$4\r\nEXEC\r\n"), "EXEC", {}));
+    QList<RedisServer::RedisRequest> requests = this->lstQueuedRequests;
+    requests.append(request);
+    this->lstQueuedRequests.clear();
+    this->boolWatching = false;
+    this->node->executeBatch(requests, this->encoder, this->socketTarget);
+
+    // the transaction fails as a whole (e.g. EXECABORT, if a command was rejected while it was queued)
+    RedisServer::RedisResponse response = request->response();
+    if(!request->isSuccess() || response->hasError()) {
+        this->fail(!request->error().isEmpty() ? request->error() : response->error());
+        return false;
+    }
+
+    // a null reply means, that a watched key was modified
+    RedisServer::RedisReply reply = response->reply();
+    if(reply.isNull() || !reply.isArray()) {
+        this->boolAborted = true;
+        this->fail("Transaction Aborted");
+        return false;
+    }
+
+    // every request receives it's element of the EXEC reply
+    for(int i = 0; i < this->lstRequests.size(); i++) {
+        RedisServer::RedisRequest& queued = this->lstRequests[i];
+        queued->response(reply.at(i).toResponse());
+        queued->finish(true);
+    }
+    this->lstRequests.clear();
+    return true;
+}
+
+void RedisTransaction::discard()
+{
+    // MULTI is not sent before the commit, so added commands are just dropped
+    if(!this->lstRequests.isEmpty()) this->fail("Transaction Discarded");
+
+    // Build and execute Command
+    // UNWATCH
+    // src: http://redis.io/commands/unwatch
+    if(this->boolWatching) {
+        this->boolWatching = false;
+        this->node->execRedisCommands({ RedisServer::RedisCommand(QByteArrayLiteral("*1\r\n$7\r\nUNWATCH\r\n"), "UNWATCH", {}) }, this->socketTarget);
+    }
+}
+
+bool RedisTransaction::optimistic(RedisServer& server, const std::list<QByteArray>& keys, Body body, int maxRetries)
+{
+    // retry, as long as the commit is aborted by a modification of a watched key
+    for(int i = 0; i <= maxRetries; i++) {
+        RedisTransaction transaction(server, keys.empty() ? QByteArray() : keys.front());
+        if(!transaction.watch(keys) || !body(transaction)) return false;
+        if(transaction.commit()) return true;
+        if(!transaction.isAborted()) return false;
+    }
+    return false;
+}
+
+void RedisTransaction::fail(const QString& error)
+{
+    // all added commands fail with the transaction
+    for(auto itr = this->lstRequests.begin(); itr != this->lstRequests.end(); itr++) {
+        (*itr)->error(error);
+        (*itr)->finish(false);
+    }
+    this->lstRequests.clear();
+    this->lstQueuedRequests.clear();
+    this->encoder.clear();
+}
@@ -1,8 +1,14 @@
 #include <QtTest/QtTest>
 
+#include <atomic>
+#include <thread>
+
 #include "redust/redisserver.h"
 #include "redust/redishash.h"
 #include "redust/redislistpoller.h"
+#include "redust/redispipeline.h"
+#include "redust/redistransaction.h"
+#include "redust/redisdecoder.h"
 
 // const variables
 #define KEYNAMESPACE "RedisTemplates_TestCase"
@@ -16,6 +22,14 @@
 
 static RedisServer redisServer(REDIS_SERVER, REDIS_SERVER_PORT);
 
+// major version of the redis server (to skip tests of unsupported features)
+static int redisMajorVersion()
+{
+    QByteArray info = redisServer.execRedisCommand({"INFO", "server"}, RedisServer::RequestType::Syncron)->response()->string();
+    int pos = info.indexOf("redis_version:");
+    return pos == -1 ? 0 : info.mid(pos + 14, info.indexOf('.', pos) - pos - 14).toInt();
+}
+
 template<typename Key, typename Value>
 class TestTemplateHelper
 {
@@ -164,6 +178,29 @@ class TestRedisHash : public QObject
         void initTestCase();
         void clear();
         void redispoller();
+        void iteratorPages();
+        void nestedReply();
+        void resp3Reply();
+        void clientCache();
+        void connectionPool();
+        void ioThread();
+        void requestHandles();
+        void coroutines();
+        void autoPipelining();
+        void pipelines();
+        void batchedSyncron();
+        void backpressure();
+        void reconnect();
+        void unixSocket();
+        void nativeTransport();
+        void cluster();
+        void replicas();
+        void bucketedHash();
+        void sharding();
+        void transactions();
+        void scripts();
+        void typedDecoding();
+        void streaming();
         void hash();
 };
 
@@ -214,6 +251,714 @@ void TestRedisHash::redispoller()
     QCOMPARE(spy.count(), pushValuesCount * 2);
 }
 
+void TestRedisHash::iteratorPages()
+{
+    // keys and values of an iterator stay valid after it moved on to the next pages (and after the receive buffer is reused)
+    QByteArray key = GENKEYNAME("IteratorPages");
+    RedisHash<QByteArray, QByteArray> hash(redisServer, key);
+    QMap<QByteArray, QByteArray> data;
+    for(int i = 0; i < 200; i++) data.insert("key" + QByteArray::number(i), QByteArray(32, 'a' + i % 26));
+    QVERIFY(hash.insert(data, RedisServer::RequestType::Syncron));
+    QMap<QByteArray, QByteArray> iterated;
+    for(auto itr = hash.begin(5); itr != hash.end(5); itr++) iterated.insert(itr.key(), itr.value());
+    for(int i = 0; i < 10; i++) redisServer.hgetall(key, RedisServer::RequestType::Syncron);
+    QCOMPARE(iterated, data);
+    hash.clear();
+}
+
+void TestRedisHash::nestedReply()
+{
+    // let redis return a nested lua table: {1, {"two", {3, "four"}}, "five"}
+    RedisServer::RedisRequest request = redisServer.execRedisCommand({"EVAL", "return {1, {'two', {3, 'four'}}, 'five'}", "0"}, RedisServer::RequestType::Syncron);
+    RedisServer::RedisReply reply = request->response()->reply();
+    QVERIFY(reply.isArray());
+    QCOMPARE(reply.size(), 3);
+    QCOMPARE(reply.at(0).integer(), (qint64)1);
+    QCOMPARE(reply.at(1).at(0).string(), QByteArray("two"));
+    QCOMPARE(reply.at(1).at(1).at(0).integer(), (qint64)3);
+    QCOMPARE(reply.at(1).at(1).at(1).string(), QByteArray("four"));
+    QCOMPARE(reply.at(2).string(), QByteArray("five"));
+}
+
+void TestRedisHash::resp3Reply()
+{
+    // RESP3 needs redis 6 or later
+    if(redisMajorVersion() < 6) QSKIP("Redis server doesn't support RESP3");
+    RedisServer resp3Server(REDIS_SERVER, REDIS_SERVER_PORT, RedisServer::Protocol::RESP3);
+
+    // HGETALL returns a native map
+    QByteArray key = GENKEYNAME("RESP3");
+    resp3Server.hset(key, "field", "value", RedisServer::RequestType::Syncron);
+    RedisServer::RedisResponse response = resp3Server.hgetall(key, RedisServer::RequestType::Syncron)->response();
+    QVERIFY(response->type() == RedisServer::RedisResponseData::Type::Map);
+    QCOMPARE(response->reply().size(), 2);
+    QCOMPARE(response->array().at(0), QByteArray("field"));
+    QCOMPARE(response->array().at(1), QByteArray("value"));
+
+    // a missing field is a native null
+    response = resp3Server.hget(key, "missing", RedisServer::RequestType::Syncron)->response();
+    QVERIFY(response->type() == RedisServer::RedisResponseData::Type::Null);
+    QVERIFY(response->reply().isNull());
+    resp3Server.del(key);
+}
+
+void TestRedisHash::clientCache()
+{
+    // client side caching needs redis 6 or later
+    if(redisMajorVersion() < 6) QSKIP("Redis server doesn't support client side caching");
+    RedisServer cachedServer(REDIS_SERVER, REDIS_SERVER_PORT);
+    QVERIFY(cachedServer.enableClientCache());
+
+    // the second read is served by the cache
+    QByteArray key = GENKEYNAME("Cache");
+    redisServer.hset(key, "field", "value1", RedisServer::RequestType::Syncron);
+    RedisHash<QByteArray, QByteArray> rHash(cachedServer, key, false, false);
+    QCOMPARE(rHash.value("field"), QByteArray("value1"));
+    QCOMPARE(rHash.value("field"), QByteArray("value1"));
+    QVERIFY(rHash.exists("field"));
+    QVERIFY(!rHash.exists("missing"));
+    QCOMPARE(cachedServer.clientCache()->hits(), (quint64)2);
+
+    // a change by another connection invalidates the cached field
+    redisServer.hset(key, "field", "value2", RedisServer::RequestType::Syncron);
+    for(int i = 0; i < 50 && cachedServer.clientCache()->invalidations() == 0; i++) QTest::qWait(10);
+    QCOMPARE(rHash.value("field"), QByteArray("value2"));
+
+    // syncron reads see invalidations, even if the event loop never runs in between
+    QCOMPARE(rHash.value("field"), QByteArray("value2"));
+    redisServer.hset(key, "field", "value3", RedisServer::RequestType::Syncron);
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray value;
+    while((value = rHash.value("field")) != "value3" && timer.elapsed() < 1000) QThread::msleep(1);
+    QCOMPARE(value, QByteArray("value3"));
+    redisServer.del(key);
+}
+
+void TestRedisHash::connectionPool()
+{
+    // distribute asyncron requests over a pool of three read/write connections
+    RedisServer poolServer(REDIS_SERVER, REDIS_SERVER_PORT);
+    poolServer.readWriteConnections(3);
+    for(RedisServer::Balancing balancing : { RedisServer::Balancing::LeastInFlight, RedisServer::Balancing::KeyHash }) {
+        poolServer.balancing(balancing);
+        QSignalSpy finished(&poolServer, &RedisServer::redisRequestsFinished);
+        for(int i = 0; i < 300; i++) poolServer.hset(GENKEYNAME("Pool") + QByteArray::number(i % 10), QByteArray::number(i), "value", RedisServer::RequestType::Asyncron);
+        QVERIFY(finished.wait(10000));
+        QCOMPARE(poolServer.pendingRequestCount(), 0);
+
+        // every hash has to contain all of it's fields
+        for(int i = 0; i < 10; i++) {
+            QCOMPARE(poolServer.hlen(GENKEYNAME("Pool") + QByteArray::number(i))->response()->integer(), 30);
+            poolServer.del(GENKEYNAME("Pool") + QByteArray::number(i));
+        }
+    }
+}
+
+void TestRedisHash::ioThread()
+{
+    // submit commands from eight threads into the io thread of one server
+    std::atomic<int> finished(0);
+    RedisServer threadedServer(REDIS_SERVER, REDIS_SERVER_PORT);
+    QVERIFY(threadedServer.startIoThread());
+    QByteArray key = GENKEYNAME("IoThread");
+    std::vector<std::thread> threads;
+    for(int t = 0; t < 8; t++) {
+        threads.emplace_back([&threadedServer, &finished, key, t]() {
+            for(int i = 0; i < 100; i++) {
+                threadedServer.submit(RedisServer::RedisCommand("HSET", { key, QByteArray::number(t * 100 + i), "value" }), [&finished](RedisServer::RedisRequest) { finished++; });
+            }
+        });
+    }
+    for(auto& thread : threads) thread.join();
+    for(int i = 0; i < 500 && finished < 800; i++) QTest::qWait(10);
+    QCOMPARE(finished.load(), 800);
+
+    // after the io thread is stopped, the server belongs to this thread again
+    threadedServer.stopIoThread();
+    QCOMPARE(threadedServer.hlen(key)->response()->integer(), 800);
+    threadedServer.del(key);
+
+    // the io thread itself may stop it (the server returns to this thread) or destroy the server (without dead locking)
+    QVERIFY(threadedServer.startIoThread());
+    QMetaObject::invokeMethod(&threadedServer, [&threadedServer]() { threadedServer.stopIoThread(); }, Qt::QueuedConnection);
+    QTRY_VERIFY(!threadedServer.isIoThreadRunning());
+    QTRY_COMPARE(threadedServer.thread(), QThread::currentThread());
+    RedisServer* destroyedServer = new RedisServer(REDIS_SERVER, REDIS_SERVER_PORT);
+    QVERIFY(destroyedServer->initConnections());
+    QVERIFY(destroyedServer->startIoThread());
+    std::atomic<bool> destroyed(false);
+    QObject::connect(destroyedServer, &QObject::destroyed, [&destroyed]() { destroyed = true; });
+    QMetaObject::invokeMethod(destroyedServer, "deleteLater", Qt::QueuedConnection);
+    QTRY_VERIFY(destroyed.load());
+}
+
+void TestRedisHash::requestHandles()
+{
+    // every asyncron request is it's own completion handle
+    QByteArray key = GENKEYNAME("Handles");
+    int callbacks = 0;
+    QList<RedisServer::RedisRequest> requests;
+    for(int i = 0; i < 50; i++) {
+        RedisServer::RedisRequest request = redisServer.hset(key, QByteArray::number(i), QByteArray::number(i * 2), RedisServer::RequestType::Asyncron);
+        request->then([&callbacks](RedisServer::RedisRequest request) { if(request->isSuccess()) callbacks++; });
+        requests << request;
+    }
+    QVERIFY(RedisServer::waitForAll(requests));
+    QCOMPARE(callbacks, 50);
+
+    // wait for a single reply
+    RedisServer::RedisRequest request = redisServer.hget(key, "21", RedisServer::RequestType::Asyncron);
+    QVERIFY(request->waitForFinished());
+    QCOMPARE(request->response()->string(), QByteArray("42"));
+
+    // the first finished request of a batch
+    RedisServer::RedisRequest any = RedisServer::whenAny({ redisServer.hlen(key, RedisServer::RequestType::Asyncron), redisServer.hlen(key, RedisServer::RequestType::Asyncron) });
+    QVERIFY(any->waitForFinished());
+    QCOMPARE(any->customData().toInt(), 0);
+    redisServer.del(key);
+}
+
+#ifdef REDUST_COROUTINES
+static RedisTask<QHash<QByteArray, QByteArray>> coroutineRoundTrip(RedisHash<QByteArray, QByteArray>& rHash)
+{
+    // straight-line code, every step suspends until it's reply is handled
+    co_await rHash.insertAsync("first", "1");
+    co_await rHash.insertAsync("second", "2");
+    QByteArray value = co_await rHash.valueAsync("first");
+    co_await rHash.insertAsync("copy", value);
+    co_return co_await rHash.toHashAsync(1);
+}
+#endif
+
+void TestRedisHash::coroutines()
+{
+#ifdef REDUST_COROUTINES
+    RedisHash<QByteArray, QByteArray> rHash(redisServer, GENKEYNAME("Coroutine"), false, false);
+    RedisTask<QHash<QByteArray, QByteArray>> task = coroutineRoundTrip(rHash);
+    for(int i = 0; i < 500 && !task.isFinished(); i++) QTest::qWait(10);
+    QVERIFY(task.isFinished());
+    QHash<QByteArray, QByteArray> hash = task.await_resume();
+    QCOMPARE(hash.size(), 3);
+    QCOMPARE(hash.value("copy"), QByteArray("1"));
+    rHash.clear();
+#else
+    QSKIP("Coroutines need C++20");
+#endif
+}
+
+void TestRedisHash::autoPipelining()
+{
+    // asyncron requests of one event loop iteration are written together (small thresholds force instant writes as well)
+    QByteArray key = GENKEYNAME("AutoPipelining");
+    redisServer.autoPipelining(true, 4096, 64);
+    QVERIFY(redisServer.isAutoPipelining());
+    QList<RedisServer::RedisRequest> requests;
+    for(int i = 0; i < 1000; i++) requests << redisServer.hset(key, QByteArray::number(i), QByteArray(i % 100, 'x'), RedisServer::RequestType::Asyncron);
+    QVERIFY(RedisServer::waitForAll(requests));
+    for(const RedisServer::RedisRequest& request : requests) QVERIFY(request->isSuccess());
+    redisServer.autoPipelining(false);
+
+    // every field was written
+    QCOMPARE(redisServer.hlen(key)->response()->integer(), 1000);
+    redisServer.del(key);
+}
+
+void TestRedisHash::pipelines()
+{
+    // independent pipelines with their own buffers (the first one is flushed automatically every 10 commands)
+    QByteArray key = GENKEYNAME("Pipelines");
+    RedisPipeline first(redisServer, key, 10);
+    RedisPipeline second(redisServer, key);
+    for(int i = 0; i < 25; i++) first.exec(&RedisServer::hset, key, QByteArray::number(i), QByteArray::number(i));
+    QCOMPARE(first.count(), 5);
+    RedisServer::RedisRequest len = second.exec(&RedisServer::hlen, key);
+    RedisServer::RedisRequest get = second.exec(std::list<QByteArray> { "HGET", key, "24" });
+
+    // a syncron flush only waits for the replies of it's own pipeline
+    QCOMPARE(first.flush(RedisServer::RequestType::Syncron), 5);
+    QCOMPARE(first.count(), 0);
+    QVERIFY(!len->isFinished());
+    QCOMPARE(second.flush(RedisServer::RequestType::Syncron), 2);
+    QCOMPARE(len->response()->integer(), 25);
+    QCOMPARE(get->response()->string(), QByteArray("24"));
+    redisServer.del(key);
+}
+
+void TestRedisHash::batchedSyncron()
+{
+    // all commands are written at once, the replies keep their order
+    QByteArray key = GENKEYNAME("Batch");
+    QList<RedisServer::RedisRequest> requests = redisServer.execRedisCommands({ RedisServer::RedisCommand("HSET", { key, "a", "1" }),
+                                                                                RedisServer::RedisCommand("HSET", { key, "b", "2" }),
+                                                                                RedisServer::RedisCommand("HGET", { key, "b" }),
+                                                                                RedisServer::RedisCommand("HLEN", { key }) });
+    QCOMPARE(requests.size(), 4);
+    for(const RedisServer::RedisRequest& request : requests) QVERIFY(request->isFinished() && request->isSuccess());
+    QCOMPARE(requests.at(2)->response()->string(), QByteArray("2"));
+    QCOMPARE(requests.at(3)->response()->integer(), 2);
+
+    // batched hash operations
+    RedisHash<QByteArray, int> rHash(redisServer, key);
+    QCOMPARE(rHash.exists(QList<QByteArray>() << "a" << "c" << "b"), QList<bool>() << true << false << true);
+    bool removed = false;
+    QCOMPARE(rHash.take("a", RedisServer::RequestType::Syncron, &removed), 1);
+    QVERIFY(removed);
+    QVERIFY(!rHash.exists(QByteArray("a")));
+    rHash.clear();
+}
+
+void TestRedisHash::backpressure()
+{
+    // a producer, which waits while paused, never exceeds the high watermark
+    QByteArray key = GENKEYNAME("Backpressure");
+    QList<bool> states;
+    QMetaObject::Connection connection = QObject::connect(&redisServer, &RedisServer::redisBackpressure, [&states](bool paused) { states << paused; });
+    redisServer.backpressure(50, 10);
+    redisServer.resetQueueStats();
+    RedisServer::RedisRequest last;
+    for(int i = 0; i < 2000; i++) {
+        if(redisServer.isPaused()) QVERIFY(redisServer.writable()->waitForFinished());
+        last = redisServer.hset(key, QByteArray::number(i), QByteArray::number(i), RedisServer::RequestType::Asyncron);
+    }
+    QVERIFY(last->waitForFinished());
+    RedisServer::QueueStats stats = redisServer.queueStats();
+    QVERIFY(stats.pauses > 0);
+    QVERIFY(stats.maxInFlight <= 50);
+    QCOMPARE(stats.inFlight, 0);
+    QVERIFY(states.size() >= 2 && states.first() && !states.at(1));
+    redisServer.backpressure(0, 0);
+    QVERIFY(!redisServer.isPaused());
+    QObject::disconnect(connection);
+    QCOMPARE(redisServer.hlen(key)->response()->integer(), 2000);
+    redisServer.del(key);
+}
+
+void TestRedisHash::reconnect()
+{
+    // connections are established asyncron and in parallel
+    RedisServer server(REDIS_SERVER, REDIS_SERVER_PORT);
+    QVERIFY(server.initConnections(true, true, 4));
+    RedisServer::RedisRequest id = server.execRedisCommand({ "CLIENT", "ID" }, RedisServer::RequestType::Asyncron);
+    QVERIFY(id->waitForFinished() && id->isSuccess());
+
+    // a killed read/write connection is reconnected transparently
+    QCOMPARE(redisServer.execRedisCommand({ "CLIENT", "KILL", "ID", QByteArray::number(id->response()->integer()) }, RedisServer::RequestType::Syncron)->response()->integer(), 1);
+    QTest::qWait(500);
+    RedisServer::RedisRequest ping = server.ping("reconnected", RedisServer::RequestType::Asyncron);
+    QVERIFY(ping->waitForFinished() && ping->isSuccess());
+    QCOMPARE(ping->response()->string(), QByteArray("reconnected"));
+
+    // unreachable servers don't kill the process, their requests fail
+    RedisServer unreachable("127.0.0.1", 1);
+    QVERIFY(!unreachable.initConnections(true, false, 0));
+    QVERIFY(!unreachable.ping("", RedisServer::RequestType::Syncron)->isSuccess());
+}
+
+void TestRedisHash::unixSocket()
+{
+    // the unix socket of the redis server is given by the environment (e.g. REDIS_SOCKET=/var/run/redis/redis.sock)
+    QByteArray path = qgetenv("REDIS_SOCKET");
+    if(path.isEmpty()) QSKIP("REDIS_SOCKET is not set");
+    RedisServer localServer("unix://" + QString::fromLocal8Bit(path));
+    QVERIFY(localServer.initConnections(true, true, 1));
+
+    // all connection types use the unix socket
+    QByteArray key = GENKEYNAME("UnixSocket");
+    QVERIFY(localServer.hset(key, "field", "value", RedisServer::RequestType::WriteOnly)->isSuccess());
+    QVERIFY(localServer.hset(key, "other", "value", RedisServer::RequestType::Asyncron)->waitForFinished());
+    QTRY_COMPARE(localServer.hget(key, "field")->response()->string(), QByteArray("value"));
+    QCOMPARE(localServer.hlen(key)->response()->integer(), 2);
+
+    // round trips of syncron requests compared to tcp loopback
+    for(RedisServer* server : { &redisServer, &localServer }) {
+        QElapsedTimer timer;
+        timer.start();
+        for(int i = 0; i < 10000; i++) server->ping("", RedisServer::RequestType::Syncron);
+        qInfo(" - 10000 syncron PINGs over %s: %lld ms", server == &localServer ? "unix socket" : "tcp", timer.elapsed());
+    }
+    localServer.del(key);
+}
+
+void TestRedisHash::nativeTransport()
+{
+#ifndef REDUST_NATIVE_TRANSPORT
+    QSKIP("native transport is not available");
+#else
+    RedisServer nativeServer(REDIS_SERVER, REDIS_SERVER_PORT, RedisServer::Protocol::RESP2, RedisServer::Transport::Native);
+    QCOMPARE(nativeServer.transport(), RedisServer::Transport::Native);
+    QVERIFY(nativeServer.initConnections(true, true, 1));
+    QVERIFY(qobject_cast<RedisNativeSocket*>(nativeServer.requestConnection(RedisServer::ConnectionType::ReadWrite)));
+
+    // all connection types and request types use the native sockets
+    QByteArray key = GENKEYNAME("NativeTransport");
+    QVERIFY(nativeServer.hset(key, "field", "value", RedisServer::RequestType::WriteOnly)->isSuccess());
+    QVERIFY(nativeServer.hset(key, "other", "value", RedisServer::RequestType::Asyncron)->waitForFinished());
+    QTRY_COMPARE(nativeServer.hget(key, "field")->response()->string(), QByteArray("value"));
+    QCOMPARE(nativeServer.hlen(key)->response()->integer(), 2);
+
+    // large values are sent partially and completed when the socket becomes writable again
+    QByteArray value(8 * 1024 * 1024, 'x');
+    QVERIFY(nativeServer.hset(key, "large", value, RedisServer::RequestType::Asyncron)->waitForFinished());
+    QCOMPARE(nativeServer.hget(key, "large")->response()->string(), value);
+
+    // pipelined requests compared to the qt sockets
+    for(RedisServer* server : { &redisServer, &nativeServer }) {
+        QElapsedTimer timer;
+        timer.start();
+        QList<RedisServer::RedisRequest> requests;
+        for(int i = 0; i < 100000; i++) requests.append(server->ping("", RedisServer::RequestType::PipeLine));
+        server->executePipeline(RedisServer::RequestType::Syncron);
+        QVERIFY(RedisServer::waitForAll(requests));
+        qInfo(" - 100000 pipelined PINGs over %s transport: %lld ms", server == &nativeServer ? "native" : "qt", timer.elapsed());
+    }
+    nativeServer.del(key);
+#endif
+}
+
+void TestRedisHash::cluster()
+{
+    // hash slots (including hash tags)
+    // src: http://redis.io/topics/cluster-spec#keys-hash-tags
+    QCOMPARE(RedisServer::hashSlot("123456789"), (quint16)12739);
+    QCOMPARE(RedisServer::hashSlot("{user1000}.following"), RedisServer::hashSlot("user1000"));
+    QCOMPARE(RedisServer::hashSlot("{user1000}.followers"), RedisServer::hashSlot("user1000"));
+    QCOMPARE(RedisServer::hashSlot("foo{bar}{zap}"), RedisServer::hashSlot("bar"));
+    QCOMPARE(RedisServer::hashSlot("foo{{bar}}zap"), RedisServer::hashSlot("{bar"));
+    QVERIFY(RedisServer::hashSlot("foo{}{bar}") != RedisServer::hashSlot("bar"));
+
+    // a node of the redis cluster is given by the environment (e.g. REDIS_CLUSTER=127.0.0.1:7000)
+    QByteArray node = qgetenv("REDIS_CLUSTER");
+    if(node.isEmpty()) QSKIP("REDIS_CLUSTER is not set");
+    RedisServer clusterServer(node.left(node.lastIndexOf(':')), node.mid(node.lastIndexOf(':') + 1).toUShort());
+    clusterServer.cluster(true);
+    QVERIFY(clusterServer.initConnections(true, true, 1));
+
+    // requests of all types are routed to the node of their key
+    QList<QByteArray> keys;
+    for(int i = 0; i < 64; i++) keys.append(GENKEYNAME("Cluster" + QByteArray::number(i)));
+    QList<RedisServer::RedisRequest> requests;
+    for(const QByteArray& key : keys) requests.append(clusterServer.hset(key, "field", key, RedisServer::RequestType::Asyncron));
+    QVERIFY(RedisServer::waitForAll(requests));
+    for(const QByteArray& key : keys) QCOMPARE(clusterServer.hget(key, "field")->response()->string(), key);
+
+    // pipelines and batches are split per node, the replies keep the order of the requests
+    RedisPipeline pipeline(clusterServer);
+    requests.clear();
+    for(const QByteArray& key : keys) requests.append(pipeline.exec(&RedisServer::hget, key, QByteArray("field")));
+    QCOMPARE(pipeline.flush(RedisServer::RequestType::Syncron), keys.size());
+    for(int i = 0; i < keys.size(); i++) QCOMPARE(requests.at(i)->response()->string(), keys.at(i));
+    std::vector<RedisServer::RedisCommand> cmds;
+    for(const QByteArray& key : keys) cmds.push_back(RedisServer::RedisCommand("HGET", { key, "field" }));
+    requests = clusterServer.execRedisCommands(cmds);
+    for(int i = 0; i < keys.size(); i++) QCOMPARE(requests.at(i)->response()->string(), keys.at(i));
+
+    // RedisHash works unchanged on top of the cluster
+    RedisHash<QByteArray, QByteArray> rHash(clusterServer, keys.front(), false, false);
+    QCOMPARE(rHash.value("field"), keys.front());
+    QCOMPARE(rHash.take("field"), keys.front());
+    QVERIFY(!rHash.exists("field"));
+
+    // requests, which are sent to the wrong node, follow the MOVED redirect
+    QIODevice* socket = clusterServer.requestConnection(RedisServer::ConnectionType::ReadWrite, keys.at(1));
+    QByteArray other;
+    for(int i = 0; other.isEmpty(); i++) {
+        QByteArray key = GENKEYNAME("ClusterOther" + QByteArray::number(i));
+        if(clusterServer.requestConnection(RedisServer::ConnectionType::ReadWrite, key) != socket) other = key;
+    }
+    RedisServer::RedisRequest request = clusterServer.execRedisCommand({"HSET", other, "field", "moved"}, RedisServer::RequestType::Asyncron, socket);
+    QVERIFY(request->waitForFinished());
+    QVERIFY(!request->response()->hasError());
+    QCOMPARE(clusterServer.hget(other, "field")->response()->string(), QByteArray("moved"));
+
+    for(const QByteArray& key : keys) clusterServer.del(key, RedisServer::RequestType::Asyncron);
+    clusterServer.del(other);
+}
+
+void TestRedisHash::replicas()
+{
+    // read only classification of the command layer
+    QVERIFY(RedisServer::isReadOnly("HGET"));
+    QVERIFY(RedisServer::isReadOnly("hgetall"));
+    QVERIFY(RedisServer::isReadOnly("HSCAN"));
+    QVERIFY(!RedisServer::isReadOnly("HSET"));
+    QVERIFY(!RedisServer::isReadOnly("DEL"));
+
+    // a replica of the test server is given by the environment (e.g. REDIS_REPLICA=127.0.0.1:6380)
+    QByteArray replica = qgetenv("REDIS_REPLICA");
+    if(replica.isEmpty()) QSKIP("REDIS_REPLICA is not set");
+    RedisServer replicatedServer(REDIS_SERVER, REDIS_SERVER_PORT);
+    replicatedServer.addReplica(replica.left(replica.lastIndexOf(':')), replica.mid(replica.lastIndexOf(':') + 1).toUShort());
+    QVERIFY(replicatedServer.initConnections());
+
+    // reads of a key, which was just written, see the write with read your writes
+    QByteArray key = GENKEYNAME("Replicas");
+    replicatedServer.readPolicy(RedisServer::ReadPolicy::ReadYourWrites, 1000);
+    for(int i = 0; i < 100; i++) {
+        replicatedServer.hset(key, "field", QByteArray::number(i), RedisServer::RequestType::Asyncron);
+        QCOMPARE(replicatedServer.hget(key, "field")->response()->string(), QByteArray::number(i));
+    }
+
+    // replicas receive the writes eventually with every other policy
+    for(RedisServer::ReadPolicy policy : { RedisServer::ReadPolicy::RoundRobin, RedisServer::ReadPolicy::LeastLatency }) {
+        replicatedServer.readPolicy(policy);
+        QTRY_COMPARE(replicatedServer.hget(key, "field")->response()->string(), QByteArray("99"));
+        QCOMPARE(replicatedServer.hgetall(key, RedisServer::RequestType::Syncron)->response()->array().size(), 2);
+        QCOMPARE(replicatedServer.hlen(key)->response()->integer(), 1);
+    }
+    replicatedServer.del(key);
+}
+
+void TestRedisHash::bucketedHash()
+{
+    // one logical hash over small physical hashes
+    QByteArray key = GENKEYNAME("Bucketed");
+    int buckets = RedisHash<int, QString>::bucketsFor(1000);
+    QCOMPARE(buckets, 11);
+    RedisHash<int, QString> hash(redisServer, key, false, false, buckets);
+    QHash<int, QString> data;
+    for(int i = 0; i < 1000; i++) data.insert(i, QString::number(i));
+    QVERIFY(hash.insert(data, RedisServer::RequestType::Syncron));
+    QVERIFY(hash.insert(1000, "1000", RedisServer::RequestType::Syncron));
+    data.insert(1000, "1000");
+
+    // every bucket stays in the compact encoding
+    for(int i = 0; i < buckets; i++) {
+        QByteArray encoding = redisServer.execRedisCommand({ "OBJECT", "ENCODING", key + ":" + QByteArray::number(i) }, RedisServer::RequestType::Syncron)->response()->string();
+        QVERIFY(encoding == "listpack" || encoding == "ziplist");
+    }
+
+    // reads are merged over all buckets
+    QVERIFY(hash.exists());
+    QCOMPARE(hash.count(), 1001);
+    QCOMPARE(hash.value(500), QString("500"));
+    QCOMPARE(hash.values(QList<int>() << 7 << 700 << 5000 << 70), QList<QString>() << "7" << "700" << QString() << "70");
+    QCOMPARE(hash.toHash(), data);
+    QCOMPARE(hash.toHash(50), data);
+    QCOMPARE(hash.keys().size(), 1001);
+    int count = 0;
+    for(auto itr = hash.begin(); itr != hash.end(); itr++) {
+        QCOMPARE(itr.value(), data.value(itr.key()));
+        count++;
+    }
+    QCOMPARE(count, 1001);
+
+    // merged QByteArray values own their data (they outlive the requests of the buckets)
+    RedisHash<QByteArray, QByteArray> bytes(redisServer, key + "Bytes", false, false, 4);
+    QVERIFY(bytes.insert(QList<QByteArray>() << "a" << "b" << "c", QList<QByteArray>() << "1" << "2" << "3", RedisServer::RequestType::Syncron));
+    QList<QByteArray> merged = bytes.values(QList<QByteArray>() << "c" << "a" << "b");
+    for(int i = 0; i < 10; i++) bytes.toHash();
+    QCOMPARE(merged, QList<QByteArray>() << "3" << "1" << "2");
+    bytes.clear();
+
+    // single fields are removed out of their bucket, clear removes all buckets
+    QVERIFY(hash.remove(500));
+    QVERIFY(!hash.exists(500));
+    QCOMPARE(hash.count(), 1000);
+    QVERIFY(hash.clear());
+    QVERIFY(!hash.exists());
+}
+
+void TestRedisHash::sharding()
+{
+    // two shards by two names of the test server (the shard of a key is the peer name of it's connection)
+    RedisServer shardedServer;
+    shardedServer.addShard(REDIS_SERVER, REDIS_SERVER_PORT);
+    shardedServer.addShard("localhost", REDIS_SERVER_PORT);
+    QVERIFY(shardedServer.isSharded());
+    QVERIFY(shardedServer.initConnections());
+    QHash<QByteArray, QString> placement;
+    int local = 0;
+    for(int i = 0; i < 1000; i++) {
+        QByteArray key = GENKEYNAME("Sharding" + QString::number(i));
+        placement.insert(key, qobject_cast<QTcpSocket*>(shardedServer.requestConnection(RedisServer::ConnectionType::ReadWrite, key))->peerName());
+        if(placement.value(key) == "localhost") local++;
+    }
+    QVERIFY(local > 350 && local < 650);
+
+    // keys with the same hash tag share their shard
+    QCOMPARE(qobject_cast<QTcpSocket*>(shardedServer.requestConnection(RedisServer::ConnectionType::ReadWrite, "{user1}.a"))->peerName(),
+             qobject_cast<QTcpSocket*>(shardedServer.requestConnection(RedisServer::ConnectionType::ReadWrite, "{user1}.b"))->peerName());
+
+    // hashes and pipelines work unchanged
+    QByteArray key = GENKEYNAME("Sharding");
+    RedisHash<QByteArray, QByteArray> hash(shardedServer, key);
+    QVERIFY(hash.insert("field", "value", RedisServer::RequestType::Syncron));
+    QCOMPARE(hash.value("field"), QByteArray("value"));
+    RedisPipeline pipeline(shardedServer);
+    RedisServer::RedisRequest len = pipeline.exec(&RedisServer::hlen, key);
+    pipeline.flush(RedisServer::RequestType::Syncron);
+    QCOMPARE(len->response()->integer(), 1);
+    QVERIFY(hash.clear());
+
+    // only the keys of a removed shard move
+    shardedServer.removeShard("localhost", REDIS_SERVER_PORT);
+    for(auto itr = placement.begin(); itr != placement.end(); itr++) {
+        if(itr.value() == "localhost") continue;
+        QCOMPARE(qobject_cast<QTcpSocket*>(shardedServer.requestConnection(RedisServer::ConnectionType::ReadWrite, itr.key()))->peerName(), itr.value());
+    }
+}
+
+void TestRedisHash::transactions()
+{
+    // queued commands receive their element of the EXEC reply
+    QByteArray key = GENKEYNAME("Transactions");
+    RedisTransaction transaction(redisServer, key);
+    RedisServer::RedisRequest set = transaction.exec(&RedisServer::hset, key, QByteArray("counter"), QByteArray("1"));
+    RedisServer::RedisRequest get = transaction.exec(&RedisServer::hget, key, QByteArray("counter"));
+    RedisServer::RedisRequest all = transaction.exec(std::list<QByteArray> { "HGETALL", key });
+    QCOMPARE(transaction.count(), 3);
+    QVERIFY(!get->isFinished());
+    QVERIFY(transaction.commit());
+    QCOMPARE(set->response()->integer(), 1);
+    QCOMPARE(get->response()->string(), QByteArray("1"));
+    QCOMPARE(all->response()->array().size(), 2);
+
+    // a watched key, which is modified before EXEC, aborts the transaction
+    QVERIFY(transaction.watch({ key }));
+    get = transaction.exec(&RedisServer::hget, key, QByteArray("counter"));
+    redisServer.hset(key, "counter", "2", RedisServer::RequestType::Syncron);
+    QVERIFY(!transaction.commit());
+    QVERIFY(transaction.isAborted());
+    QVERIFY(get->isFinished() && !get->isSuccess());
+
+    // read-modify-write is retried, until no other client modified the key in between
+    int attempts = 0;
+    QVERIFY(RedisTransaction::optimistic(redisServer, { key }, [&](RedisTransaction& transaction) {
+        int counter = redisServer.hget(key, "counter")->response()->string().toInt();
+        if(attempts++ == 0) redisServer.hset(key, "counter", "10", RedisServer::RequestType::Syncron);
+        transaction.exec(&RedisServer::hset, key, QByteArray("counter"), QByteArray::number(counter + 1));
+        return true;
+    }));
+    QCOMPARE(attempts, 2);
+    QCOMPARE(redisServer.hget(key, "counter")->response()->string(), QByteArray("11"));
+    redisServer.del(key);
+
+    // hashes take, remove and conditionally insert fields atomically
+    RedisHash<QByteArray, QByteArray> hash(redisServer, key);
+    QVERIFY(hash.insert(QList<QByteArray>() << "a" << "b" << "c", QList<QByteArray>() << "1" << "2" << "3", RedisServer::RequestType::Syncron));
+    QVERIFY(hash.insert(QList<QByteArray>() << "a" << "d", QList<QByteArray>() << "4" << "5", RedisServer::RequestType::Syncron, false));
+    QCOMPARE(hash.value("a"), QByteArray("1"));
+    QCOMPARE(hash.value("d"), QByteArray("5"));
+    bool removed = false;
+    QCOMPARE(hash.take("b", RedisServer::RequestType::Syncron, &removed), QByteArray("2"));
+    QVERIFY(removed);
+    QVERIFY(hash.remove(QList<QByteArray>() << "a" << "c"));
+    QCOMPARE(hash.keys(), QList<QByteArray>() << "d");
+
+    // other request types keep their semantics (every field is an own request, so they don't block)
+    QVERIFY(hash.insert(QList<QByteArray>() << "d" << "e", QList<QByteArray>() << "6" << "7", RedisServer::RequestType::Asyncron, false));
+    QTRY_COMPARE(hash.count(), 2);
+    QCOMPARE(hash.value("d"), QByteArray("5"));
+    QVERIFY(hash.remove(QList<QByteArray>() << "d" << "e", RedisServer::RequestType::Asyncron));
+    QTRY_COMPARE(hash.count(), 0);
+    hash.clear();
+}
+
+void TestRedisHash::scripts()
+{
+    // loaded scripts are executed by EVALSHA (and by EVAL, if the script cache of the server was flushed)
+    QByteArray key = GENKEYNAME("Scripts");
+    QByteArray sha = redisServer.loadScript("return redis.call('HSET', KEYS[1], ARGV[1], ARGV[2])");
+    QCOMPARE(sha.size(), 40);
+    QCOMPARE(redisServer.evalScript(sha, { key }, { "a", "1" })->response()->integer(), 1);
+    redisServer.execRedisCommand({ "SCRIPT", "FLUSH" }, RedisServer::RequestType::Syncron);
+    RedisServer::RedisRequest request = redisServer.evalScript(sha, { key }, { "b", "2" });
+    QVERIFY(!request->response()->hasError());
+    QCOMPARE(request->response()->integer(), 1);
+    QCOMPARE(redisServer.hlen(key)->response()->integer(), 2);
+    redisServer.del(key);
+
+    // hashes take, compare and move fields with one script call
+    RedisHash<QByteArray, QByteArray> hash(redisServer, key, false, false, 4);
+    RedisHash<QByteArray, QByteArray> target(redisServer, GENKEYNAME("ScriptsTarget"));
+    QVERIFY(hash.insert(QList<QByteArray>() << "a" << "b" << "c" << "d", QList<QByteArray>() << "1" << "2" << "3" << "4", RedisServer::RequestType::Syncron));
+    QCOMPARE(hash.take("a"), QByteArray("1"));
+    QCOMPARE(hash.takeMany(QList<QByteArray>() << "c" << "x" << "b"), QList<QByteArray>() << "3" << QByteArray() << "2");
+    QCOMPARE(hash.count(), 1);
+    QVERIFY(!hash.compareAndSet("d", "5", "6"));
+    QVERIFY(hash.compareAndSet("d", "4", "6"));
+    QVERIFY(hash.moveTo("d", target));
+    QVERIFY(!hash.moveTo("d", target));
+    QCOMPARE(target.value("d"), QByteArray("6"));
+    QVERIFY(!hash.exists());
+    target.clear();
+}
+
+void TestRedisHash::typedDecoding()
+{
+    // typed commands decode their reply directly into the given target
+    QByteArray key = GENKEYNAME("TypedDecoding");
+    QVERIFY(!redisServer.hmset(key, std::list<QByteArray>() << "1" << "2" << "3", std::list<QByteArray>() << "10" << "20" << "30", RedisServer::RequestType::Syncron)->response()->hasError());
+    qint64 count = 0;
+    QVERIFY(RedisDecoder::hlen(redisServer, key, count));
+    QCOMPARE(count, (qint64)3);
+    int value = 0;
+    bool found = false;
+    QVERIFY(RedisDecoder::hget<int>(redisServer, key, "2", value, false, &found));
+    QVERIFY(found);
+    QCOMPARE(value, 20);
+    QVERIFY(RedisDecoder::hget<int>(redisServer, key, "4", value, false, &found));
+    QVERIFY(!found);
+    QHash<int, int> entries;
+    QVERIFY((RedisDecoder::hgetall<int, int>(redisServer, key, entries, false, false)));
+    QCOMPARE(entries.value(3), 30);
+    QCOMPARE(entries.size(), 3);
+    QList<int> values;
+    QVERIFY(RedisDecoder::hmget<int>(redisServer, key, { "3", "1" }, values, false));
+    QCOMPARE(values, QList<int>() << 30 << 10);
+    int cursor = 0;
+    QList<int> keys;
+    do QVERIFY(RedisDecoder::hscan(redisServer, key, cursor, RedisDecoder::List<int>(keys, false, 0, 2), 1)); while(cursor);
+    QCOMPARE(keys.size(), 3);
+
+    // errors are not decoded, and hashes read through the same decoders
+    QByteArray stringKey = GENKEYNAME("TypedDecodingString");
+    redisServer.execRedisCommand({ "SET", stringKey, "x" }, RedisServer::RequestType::Syncron);
+    QVERIFY(!RedisDecoder::hlen(redisServer, stringKey, count));
+    QCOMPARE(count, (qint64)3);
+    redisServer.del(stringKey);
+    RedisHash<int, QString> hash(redisServer, key);
+    QCOMPARE(hash.count(), 3);
+    QCOMPARE(hash.value(1), QString("10"));
+    QCOMPARE(hash.toHash().value(2), QString("20"));
+    QCOMPARE(hash.toMap(1).size(), 3);
+    QCOMPARE(hash.values(QList<int>() << 3 << 5), QList<QString>() << "30" << QString());
+    hash.clear();
+}
+
+void TestRedisHash::streaming()
+{
+    // the fields of a hash are visited while the reply is received (also over several buckets and receive buffer chunks)
+    QByteArray key = GENKEYNAME("Streaming");
+    for(int buckets : { 1, 4 }) {
+        RedisHash<int, QByteArray> hash(redisServer, key, false, false, buckets);
+        QList<int> keys;
+        QList<QByteArray> values;
+        for(int i = 0; i < 20000; i++) {
+            keys << i;
+            values << QByteArray(16, 'a' + i % 26);
+        }
+        QVERIFY(hash.insert(keys, values, RedisServer::RequestType::Syncron));
+        qint64 sum = 0;
+        int count = 0;
+        QVERIFY(hash.forEach([&](int k, const QByteArray& v) { sum += k; count += v == QByteArray(16, 'a' + k % 26); return true; }));
+        QCOMPARE(sum, (qint64)19999 * 20000 / 2);
+        QCOMPARE(count, 20000);
+        count = 0;
+        QVERIFY(hash.forEachKey([&](int) { count++; return true; }));
+        QVERIFY(hash.forEachValue([&](const QByteArray& v) { count += v.size() == 16; return true; }));
+        QCOMPARE(count, 40000);
+
+        // a visitor, which stops early, skips the remaining fields (and the connection stays in order)
+        count = 0;
+        QVERIFY(hash.forEach([&](int, const QByteArray&) { return ++count < 10; }));
+        QCOMPARE(count, 10);
+        QCOMPARE(hash.count(), 20000);
+        hash.clear();
+    }
+}
+
 void TestRedisHash::hash()
 {
     // key index